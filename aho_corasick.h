@@ -0,0 +1,325 @@
+/*! \file
+    \author Alexander Martynov (Marty AKA al-martyn1) <amart@mail.ru>
+    \copyright (c) 2014-2026 Alexander Martynov
+    \brief Автомат Ахо-Корасик для одновременного поиска всех ключей marty::containers::trie в потоке
+
+    Repository: https://github.com/al-martyn1/marty_containers
+
+    Автомат строится поверх готового trie и ссылается на него: переходы выполняются по узлам trie,
+    автомат добавляет только ссылки неудач (failure) и выходные ссылки (output). После построения
+    автомата trie не должен изменяться и должен существовать, пока используется автомат.
+
+    Состояние автомата - префикс одного из ключей trie. Состояние 0 - корень (пустой префикс),
+    состояния элементов узла trie с индексом n идут подряд, начиная с node_first_state[n].
+*/
+
+#pragma once
+
+#include "trie.h"
+//
+
+#include <cstddef>
+#include <deque>
+#include <utility>
+#include <vector>
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+// marty::containers::
+namespace marty {
+namespace containers {
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+template < typename KeyType
+         , typename ValueType
+         , typename Traits    = std::less< KeyType >
+         , typename IndexType = std::size_t
+         , typename Allocator = std::allocator< ValueType >
+         >
+class aho_corasick
+{
+
+public: // types
+
+    typedef KeyType                                   key_type;
+    typedef ValueType                                 mapped_type;
+    typedef Traits                                    key_compare;
+    typedef IndexType                                 index_type;
+    typedef Allocator                                 allocator_type;
+    typedef std::size_t                               size_type;
+
+    typedef trie< key_type, mapped_type, key_compare, index_type, allocator_type > trie_type;
+
+    typedef IndexType                                 state_index;
+    static constexpr state_index                      state_index_npos = static_cast<state_index>(-1);
+
+    typedef typename trie_type::trie_node_index       trie_node_index;
+    typedef typename trie_type::value_index           value_index;
+
+    struct state_info
+    {
+        trie_node_index    child_node; // trie node with continuations of the prefix, or npos
+        state_index        fail;       // longest proper suffix of the prefix, which is a state too
+        state_index        output;     // nearest payloaded state in the fail chain, or npos
+        value_index        value_idx;  // payload of the prefix in the source trie, or npos
+        index_type         depth;      // prefix length
+    };
+
+    typedef std::vector< state_info >                 states_holder;
+    typedef std::vector< state_index >                node_states_holder;
+
+    //! Найденное вхождение, используется при параллельном поиске
+    struct match
+    {
+        size_type           offset;
+        size_type           length;
+        const mapped_type  *value;
+    };
+
+    //! Состояние потокового поиска, позволяет продолжать поиск в следующем фрагменте входных данных
+    struct scan_state
+    {
+        state_index        state  = 0;
+        size_type          offset = 0; //!< Смещение следующего элемента во всём потоке
+
+        void reset() { state = 0; offset = 0; }
+    };
+
+
+protected: // member fields
+
+    const trie_type              *pTrie;
+    states_holder                 states;
+    node_states_holder            node_first_state;
+    size_type                     max_key_len;
+
+
+public: // ctors
+
+    aho_corasick() : pTrie(0), states(), node_first_state(), max_key_len(0) {}
+
+    explicit aho_corasick( const trie_type &t ) : pTrie(0), states(), node_first_state(), max_key_len(0)
+    {
+        build(t);
+    }
+
+    aho_corasick( const aho_corasick & ) = default;
+    aho_corasick( aho_corasick && ) = default;
+    aho_corasick& operator=( const aho_corasick & ) = default;
+    aho_corasick& operator=( aho_corasick && ) = default;
+
+    void swap( aho_corasick &a )
+    {
+        std::swap(pTrie, a.pTrie);
+        states          .swap(a.states          );
+        node_first_state.swap(a.node_first_state);
+        std::swap(max_key_len, a.max_key_len);
+    }
+
+    void clear()
+    {
+        pTrie = 0;
+        states          .clear();
+        node_first_state.clear();
+        max_key_len = 0;
+    }
+
+    //! Строит ссылки неудач и выходные ссылки по готовому trie
+    void build( const trie_type &t );
+
+
+public: // scan API
+
+    const trie_type* get_trie() const { return pTrie; }
+
+    size_type states_size() const { return states.size(); }
+
+    //! Длина самого длинного ключа trie (глубина trie); вхождение не может быть длиннее
+    size_type max_depth() const { return max_key_len; }
+
+    const states_holder& get_states() const { return states; }
+
+    //! Переход автомата по элементу ключа с учётом ссылок неудач
+    state_index next_state( state_index s, const key_type &k ) const
+    {
+        for(;;)
+           {
+            state_index t = goto_state( s, k );
+            if (t!=state_index_npos)
+               return t;
+            if (s==0)
+               return 0;
+            s = states[s].fail;
+           }
+    }
+
+    //! Поиск всех вхождений ключей trie в [b,e) за один проход
+    /*! Для каждого вхождения вызывается h(offset, length, value), где offset - смещение начала вхождения
+        от начала потока. Вхождения сообщаются в порядке их окончания, при общем окончании - от длинного к короткому.
+        Возвращает количество найденных вхождений.
+     */
+    template<typename KeyIter, typename Handler>
+    size_type scan( scan_state &st, KeyIter b, const KeyIter &e, Handler h ) const;
+
+    template<typename KeyIter, typename Handler>
+    size_type scan( KeyIter b, const KeyIter &e, Handler h ) const
+    {
+        scan_state st;
+        return scan( st, b, e, h );
+    }
+
+    size_type get_used_mem() const
+    {
+        return sizeof(states_holder)      + states.capacity()*sizeof(state_info)
+             + sizeof(node_states_holder) + node_first_state.capacity()*sizeof(state_index)
+             ;
+    }
+
+
+protected: // impl helpers
+
+    // transition by trie edge only, npos if there is no such edge
+    state_index goto_state( state_index s, const key_type &k ) const
+    {
+        trie_node_index n = states[s].child_node;
+        if (n==trie_type::trie_node_index_npos)
+           return state_index_npos;
+
+        typename trie_type::trie_node_data_item_index idx = pTrie->trie_nodes[n].find_key_idx( pTrie, k );
+        if (idx==trie_type::trie_node_data_item_index_npos)
+           return state_index_npos;
+
+        return static_cast<state_index>(node_first_state[n] + idx);
+    }
+
+}; // class aho_corasick
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
+inline void
+aho_corasick<KeyType,ValueType,Traits,IndexType,Allocator > :: build( const trie_type &t )
+{
+    typedef typename trie_type::trie_node_data_item_index  trie_node_data_item_index;
+
+    clear();
+    pTrie = &t;
+
+    state_info root;
+    root.child_node = (t.trie_nodes.empty() || !t.trie_nodes[0].keys_size()) ? trie_type::trie_node_index_npos : trie_node_index(0);
+    root.fail       = 0;
+    root.output     = state_index_npos;
+    root.value_idx  = trie_type::value_index_npos;
+    root.depth      = 0;
+    states.push_back(root);
+
+    node_first_state.assign(t.trie_nodes.size(), state_index_npos);
+
+    // BFS: fail targets are shorter prefixes, so their states are complete before they are used
+    std::deque< state_index > queue;
+    queue.push_back(0);
+
+    while(!queue.empty())
+    {
+        const state_index s = queue.front();
+        queue.pop_front();
+
+        const trie_node_index nodeIdx = states[s].child_node;
+        if (nodeIdx==trie_type::trie_node_index_npos)
+            continue;
+
+        const typename trie_type::trie_node &node = t.trie_nodes[nodeIdx];
+        const trie_node_data_item_index nodeSize = node.keys_size();
+
+        trie_type::check_index_overflow( states.size() + nodeSize, "aho_corasick state" );
+        node_first_state[nodeIdx] = static_cast<state_index>(states.size());
+
+        for(trie_node_data_item_index idx=0; idx!=nodeSize; ++idx)
+        {
+            const typename trie_type::trie_node_data_item &item = node.get_data_item(&t, idx);
+
+            state_index f = 0;
+            if (s!=0)
+            {
+                f = states[s].fail;
+                for(;;)
+                {
+                    state_index g = goto_state( f, item.key );
+                    if (g!=state_index_npos)
+                    {
+                        f = g;
+                        break;
+                    }
+                    if (f==0)
+                        break;
+                    f = states[f].fail;
+                }
+            }
+
+            state_info si;
+            si.child_node = item.child_idx;
+            si.fail       = f;
+            si.output     = states[f].value_idx!=trie_type::value_index_npos ? f : states[f].output;
+            si.value_idx  = item.value_idx;
+            si.depth      = static_cast<index_type>(states[s].depth + 1);
+
+            if (si.depth>max_key_len)
+                max_key_len = si.depth;
+
+            queue.push_back(static_cast<state_index>(states.size()));
+            states.push_back(si);
+        }
+    }
+
+    states.shrink_to_fit();
+}
+
+//----------------------------------------------------------------------------
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
+template<typename KeyIter, typename Handler>
+inline typename aho_corasick<KeyType,ValueType,Traits,IndexType,Allocator > :: size_type
+aho_corasick<KeyType,ValueType,Traits,IndexType,Allocator > :: scan( scan_state &st, KeyIter b, const KeyIter &e, Handler h ) const
+{
+    size_type nMatches = 0;
+
+    if (states.empty())
+        return nMatches;
+
+    state_index s      = st.state;
+    size_type   offset = st.offset;
+
+    for(; b!=e; ++b)
+    {
+        s = next_state( s, *b );
+        ++offset;
+
+        state_index m = states[s].value_idx!=trie_type::value_index_npos ? s : states[s].output;
+        for(; m!=state_index_npos; m=states[m].output)
+        {
+            const state_info &si = states[m];
+            h( offset - si.depth, (size_type)si.depth, pTrie->values[si.value_idx] );
+            ++nMatches;
+        }
+    }
+
+    st.state  = s;
+    st.offset = offset;
+
+    return nMatches;
+}
+
+//----------------------------------------------------------------------------
+
+} // namespace containers
+} // namespace marty
+
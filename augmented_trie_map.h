@@ -0,0 +1,396 @@
+/*! \file
+    \author Alexander Martynov (Marty AKA al-martyn1) <amart@mail.ru>
+    \copyright (c) 2014-2026 Alexander Martynov
+    \brief trie_map с агрегатами поддеревьев (моноид над значениями): свёртка по префиксу за O(длина префикса)
+
+    Repository: https://github.com/al-martyn1/marty_containers
+
+    Для каждого узла trie хранится свёртка значений всех ключей его поддерева в порядке ключей.
+    Агрегат узла пересчитывается из агрегатов дочерних узлов, поэтому изменение одного ключа
+    пересчитывает только узлы на пути ключа - O(глубина * ширина узла).
+
+    Моноид - тип с членами:
+      value_type                     - тип агрегата
+      identity()                     - нейтральный элемент
+      lift(const mapped_type&)       - агрегат одного значения
+      operator()(a, b)               - ассоциативная операция (коммутативность не требуется)
+
+    Изменять содержимое можно только через методы augmented_trie_map, иначе агрегаты устаревают
+    (их можно восстановить вызовом rebuild()).
+*/
+
+#pragma once
+
+#include "trie.h"
+//
+
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+// marty::containers::
+namespace marty {
+namespace containers {
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+//! Количество ключей
+template<typename ValueType>
+struct trie_count_monoid
+{
+    typedef std::size_t value_type;
+
+    value_type identity() const                                        { return 0; }
+    value_type lift( const ValueType & ) const                         { return 1; }
+    value_type operator()( const value_type &a, const value_type &b ) const { return a+b; }
+
+}; // struct trie_count_monoid
+
+//----------------------------------------------------------------------------
+//! Сумма значений
+template<typename ValueType>
+struct trie_sum_monoid
+{
+    typedef ValueType value_type;
+
+    value_type identity() const                                        { return value_type(); }
+    value_type lift( const ValueType &v ) const                        { return v; }
+    value_type operator()( const value_type &a, const value_type &b ) const { return a+b; }
+
+}; // struct trie_sum_monoid
+
+//----------------------------------------------------------------------------
+//! Минимальное значение, для пустого множества - std::numeric_limits<ValueType>::max()
+template<typename ValueType>
+struct trie_min_monoid
+{
+    typedef ValueType value_type;
+
+    value_type identity() const                                        { return std::numeric_limits<ValueType>::max(); }
+    value_type lift( const ValueType &v ) const                        { return v; }
+    value_type operator()( const value_type &a, const value_type &b ) const { return b<a ? b : a; }
+
+}; // struct trie_min_monoid
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+template < typename KeyType
+         , typename ValueType
+         , typename Monoid    = trie_count_monoid< ValueType >
+         , typename Traits    = std::less< typename KeyType::value_type >
+         , typename IndexType = std::size_t
+         >
+class augmented_trie_map
+{
+
+public: // types
+
+    typedef trie_map< KeyType, ValueType, Traits, IndexType >  map_type;
+    typedef typename map_type::trie_type                       trie_type;
+
+    typedef typename map_type::key_type                        key_type;
+    typedef typename map_type::mapped_type                     mapped_type;
+    typedef typename map_type::key_compare                     key_compare;
+    typedef typename map_type::value_type                      value_type;
+    typedef typename map_type::size_type                       size_type;
+    typedef typename map_type::const_iterator                  const_iterator;
+
+    typedef Monoid                                             monoid_type;
+    typedef typename Monoid::value_type                        aggregate_type;
+
+    typedef std::vector< aggregate_type >                      aggregates_holder;
+
+protected: // types
+
+    typedef typename trie_type::trie_node_index                trie_node_index;
+    typedef typename trie_type::trie_node_data_item_index      trie_node_data_item_index;
+    typedef typename trie_type::trie_node_data_item            trie_node_data_item;
+    typedef typename trie_type::trie_node                      trie_node;
+
+
+protected: // member fields
+
+    map_type               m_map;
+    monoid_type            m_monoid;
+    aggregates_holder      node_aggregates; // indexed by trie node index
+
+
+public: // ctors
+
+    augmented_trie_map() : m_map(), m_monoid(), node_aggregates() {}
+
+    explicit
+    augmented_trie_map( const monoid_type &m ) : m_map(), m_monoid(m), node_aggregates() {}
+
+    template<class InputIterator>
+    augmented_trie_map( InputIterator f, InputIterator l, const monoid_type &m = monoid_type() )
+    : m_map(f, l), m_monoid(m), node_aggregates()
+    {
+        rebuild();
+    }
+
+    augmented_trie_map( const augmented_trie_map & ) = default;
+    augmented_trie_map( augmented_trie_map && ) = default;
+    augmented_trie_map& operator=( const augmented_trie_map & ) = default;
+    augmented_trie_map& operator=( augmented_trie_map && ) = default;
+
+    void swap( augmented_trie_map &m )
+    {
+        m_map.swap(m.m_map);
+        std::swap(m_monoid, m.m_monoid);
+        node_aggregates.swap(m.node_aggregates);
+    }
+
+
+public: // read API
+
+    //! Только для чтения - изменения в обход augmented_trie_map не отражаются в агрегатах
+    const map_type& get_map() const        { return m_map; }
+    const monoid_type& get_monoid() const  { return m_monoid; }
+
+    size_type size() const                 { return m_map.size(); }
+    bool empty() const                     { return m_map.size()==0; }
+
+    const_iterator begin() const           { return m_map.begin(); }
+    const_iterator end() const             { return m_map.end(); }
+
+    const mapped_type* find_value( const key_type &k ) const { return m_map.find_value(k); }
+    const_iterator find( const key_type &k ) const           { return m_map.find(k); }
+    size_type count( const key_type &k ) const               { return m_map.count(k); }
+
+    const_iterator nth( size_type k ) const                  { return m_map.nth(k); }
+    size_type rank( const key_type &k ) const                { return m_map.rank(k); }
+    size_type count_prefix( const key_type &prefix ) const   { return m_map.count_prefix(prefix); }
+
+    std::pair<const_iterator,const_iterator> prefix_range( const key_type &prefix ) const
+    {
+        return m_map.prefix_range(prefix);
+    }
+
+    //! Свёртка значений всех ключей
+    aggregate_type aggregate() const
+    {
+        return node_aggregates.empty() ? m_monoid.identity() : node_aggregates[0];
+    }
+
+    //! Свёртка значений всех ключей, начинающихся с prefix (включая сам prefix)
+    aggregate_type aggregate_prefix( const key_type &prefix ) const;
+
+    size_type get_used_mem() const
+    {
+        return m_map.get_used_mem() + sizeof(aggregates_holder) + node_aggregates.capacity()*sizeof(aggregate_type);
+    }
+
+
+public: // modify API
+
+    //! Вставляет или заменяет значение, возвращает true, если ключ был добавлен
+    bool insert_or_assign( const key_type &k, const mapped_type &v )
+    {
+        bool newInserted = m_map.count(k)==0;
+        m_map[k] = v;
+        update_path(k);
+        return newInserted;
+    }
+
+    //! Вставляет v, если ключа нет; возвращает true, если ключ добавлен
+    bool insert( const value_type &v )
+    {
+        if (m_map.find_value(v.first))
+            return false; // trie_map::insert replaces the value
+        m_map.insert(v);
+        update_path(v.first);
+        return true;
+    }
+
+    size_type erase( const key_type &k )
+    {
+        size_type res = m_map.erase(k);
+        if (res)
+            update_path(k);
+        return res;
+    }
+
+    void clear()
+    {
+        m_map.clear();
+        node_aggregates.clear();
+    }
+
+    //! См. trie::compact; индексы узлов меняются, поэтому агрегаты строятся заново
+    void compact()
+    {
+        m_map.compact();
+        rebuild();
+    }
+
+    //! Пересчитывает агрегаты всех узлов
+    void rebuild();
+
+
+protected: // impl helpers
+
+    const trie_type& get_trie() const { return m_map.get_base(); }
+
+    // fold of item value and item subtree
+    aggregate_type item_aggregate( const trie_node_data_item &item ) const
+    {
+        const trie_type &t = get_trie();
+        aggregate_type res = m_monoid.identity();
+        if (item.value_idx!=trie_type::value_index_npos)
+            res = m_monoid( res, m_monoid.lift(t.values[item.value_idx]) );
+        if (item.child_idx!=trie_type::trie_node_index_npos)
+            res = m_monoid( res, node_aggregates[item.child_idx] );
+        return res;
+    }
+
+    // children aggregates must be up to date
+    void recompute_node( trie_node_index n )
+    {
+        const trie_type &t    = get_trie();
+        const trie_node &node = t.trie_nodes[n];
+        const trie_node_data_item_index nodeSize = node.keys_size();
+
+        aggregate_type res = m_monoid.identity();
+        for(trie_node_data_item_index idx=0; idx!=nodeSize; ++idx)
+            res = m_monoid( res, item_aggregate(node.get_data_item(&t, idx)) );
+        node_aggregates[n] = res;
+    }
+
+    //! Пересчитывает узлы на пути ключа k снизу вверх
+    void update_path( const key_type &k );
+
+}; // class augmented_trie_map
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+template < typename KeyType, typename ValueType, typename Monoid, typename Traits, typename IndexType >
+inline typename augmented_trie_map<KeyType,ValueType,Monoid,Traits,IndexType > :: aggregate_type
+augmented_trie_map<KeyType,ValueType,Monoid,Traits,IndexType > :: aggregate_prefix( const key_type &prefix ) const
+{
+    const trie_type &t = get_trie();
+
+    typename key_type::const_iterator b = prefix.begin(), e = prefix.end();
+    if (b==e)
+        return aggregate();
+
+    if (t.trie_nodes.empty())
+        return m_monoid.identity();
+
+    trie_node_index nodeIdx = 0;
+    for(;;)
+    {
+        const trie_node &node = t.trie_nodes[nodeIdx];
+        if (!node.keys_size())
+            return m_monoid.identity();
+
+        trie_node_data_item_index idx = node.find_key_idx( &t, *b );
+        if (idx==trie_type::trie_node_data_item_index_npos)
+            return m_monoid.identity();
+
+        const trie_node_data_item &item = node.get_data_item(&t, idx);
+        if (++b==e)
+            return item_aggregate(item);
+
+        nodeIdx = item.child_idx;
+        if (nodeIdx==trie_type::trie_node_index_npos)
+            return m_monoid.identity();
+    }
+}
+
+//----------------------------------------------------------------------------
+template < typename KeyType, typename ValueType, typename Monoid, typename Traits, typename IndexType >
+inline void
+augmented_trie_map<KeyType,ValueType,Monoid,Traits,IndexType > :: update_path( const key_type &k )
+{
+    const trie_type &t = get_trie();
+
+    if (!m_map.size() || t.trie_nodes.empty())
+    {
+        node_aggregates.clear();
+        return;
+    }
+
+    // nodes, added by insert, have no aggregates yet, but they are on the path
+    node_aggregates.resize(t.trie_nodes.size(), m_monoid.identity());
+
+    // erase may prune the tail of the path, so the walk stops on the first missing item
+    std::vector<trie_node_index> path;
+    trie_node_index nodeIdx = 0;
+    typename key_type::const_iterator b = k.begin(), e = k.end();
+    for(; b!=e && nodeIdx!=trie_type::trie_node_index_npos; ++b)
+    {
+        const trie_node &node = t.trie_nodes[nodeIdx];
+        if (!node.keys_size())
+            break;
+
+        path.push_back(nodeIdx);
+
+        trie_node_data_item_index idx = node.find_key_idx( &t, *b );
+        if (idx==trie_type::trie_node_data_item_index_npos)
+            break;
+
+        nodeIdx = node.get_data_item(&t, idx).child_idx;
+    }
+
+    for(typename std::vector<trie_node_index>::const_reverse_iterator it=path.rbegin(); it!=path.rend(); ++it)
+        recompute_node(*it);
+}
+
+//----------------------------------------------------------------------------
+template < typename KeyType, typename ValueType, typename Monoid, typename Traits, typename IndexType >
+inline void
+augmented_trie_map<KeyType,ValueType,Monoid,Traits,IndexType > :: rebuild()
+{
+    const trie_type &t = get_trie();
+
+    node_aggregates.clear();
+    if (!m_map.size() || t.trie_nodes.empty())
+        return;
+
+    node_aggregates.assign(t.trie_nodes.size(), m_monoid.identity());
+
+    // reverse preorder visits children before parents
+    std::vector<trie_node_index> order;
+    std::vector<trie_node_index> stack;
+    stack.push_back(0);
+    while(!stack.empty())
+    {
+        const trie_node_index n = stack.back();
+        stack.pop_back();
+        order.push_back(n);
+
+        const trie_node &node = t.trie_nodes[n];
+        const trie_node_data_item_index nodeSize = node.keys_size();
+        for(trie_node_data_item_index idx=0; idx!=nodeSize; ++idx)
+        {
+            const trie_node_index child = node.get_data_item(&t, idx).child_idx;
+            if (child!=trie_type::trie_node_index_npos && t.trie_nodes[child].keys_size())
+                stack.push_back(child);
+        }
+    }
+
+    for(typename std::vector<trie_node_index>::const_reverse_iterator it=order.rbegin(); it!=order.rend(); ++it)
+        recompute_node(*it);
+}
+
+//----------------------------------------------------------------------------
+
+} // namespace containers
+} // namespace marty
+
@@ -0,0 +1,159 @@
+/*! \file
+    \author Alexander Martynov (Marty AKA al-martyn1) <amart@mail.ru>
+    \copyright (c) 2014-2026 Alexander Martynov
+    \brief Поиск в отсортированных массивах однобайтовых ключей (SSE2/AVX2 со скалярным fallback)
+
+    Repository: https://github.com/al-martyn1/marty_containers
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+
+//----------------------------------------------------------------------------
+// MARTY_CONTAINERS_NO_SIMD - запрещает использование SIMD-реализаций
+
+#if !defined(MARTY_CONTAINERS_NO_SIMD)
+
+    #if defined(__AVX2__)
+        #define MARTY_CONTAINERS_BYTE_SEARCH_AVX2
+    #endif
+
+    #if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+        #define MARTY_CONTAINERS_BYTE_SEARCH_SSE2
+    #endif
+
+#endif
+
+#if defined(MARTY_CONTAINERS_BYTE_SEARCH_AVX2)
+    #include <immintrin.h>
+#elif defined(MARTY_CONTAINERS_BYTE_SEARCH_SSE2)
+    #include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER) && (defined(MARTY_CONTAINERS_BYTE_SEARCH_AVX2) || defined(MARTY_CONTAINERS_BYTE_SEARCH_SSE2))
+    #include <intrin.h>
+#endif
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+// marty::containers::
+namespace marty {
+namespace containers {
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+//! Признак применимости байтового поиска: однобайтовый целый ключ (не bool) и std::less
+template<typename KeyType, typename Compare>
+struct byte_key_search_traits
+{
+    static constexpr bool enabled = sizeof(KeyType)==1
+                                 && std::is_integral<KeyType>::value
+                                 && !std::is_same<KeyType,bool>::value
+                                 && (  std::is_same<Compare, std::less<KeyType> >::value
+                                    || std::is_same<Compare, std::less<void> >::value
+                                    );
+
+    static constexpr bool is_signed = std::is_signed<KeyType>::value;
+
+}; // struct byte_key_search_traits
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+namespace byte_search_impl {
+
+#if defined(MARTY_CONTAINERS_BYTE_SEARCH_AVX2) || defined(MARTY_CONTAINERS_BYTE_SEARCH_SSE2)
+
+inline unsigned ctz32(std::uint32_t v)
+{
+    #if defined(_MSC_VER)
+    unsigned long idx = 0;
+    _BitScanForward(&idx, v);
+    return (unsigned)idx;
+    #else
+    return (unsigned)__builtin_ctz(v);
+    #endif
+}
+
+#endif
+
+// Scalar fallback and tail of SIMD search
+template<typename KeyType>
+inline std::size_t lower_bound_scalar(const KeyType *p, std::size_t pos, std::size_t n, KeyType k)
+{
+    return (std::size_t)(std::lower_bound(p+pos, p+n, k) - p);
+}
+
+} // namespace byte_search_impl
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+//! Возвращает индекс первого элемента, не меньшего k, в отсортированном по std::less массиве p[0..n)
+/*! Сравнение выполняется блоками по 32 (AVX2) или 16 (SSE2) элементов с movemask,
+    хвост массива обрабатывается скалярно.
+ */
+template<typename KeyType>
+inline std::size_t byte_lower_bound(const KeyType *p, std::size_t n, KeyType k)
+{
+    static_assert(sizeof(KeyType)==1 && std::is_integral<KeyType>::value, "byte_lower_bound requires 1-byte integral key type");
+
+    std::size_t pos = 0;
+
+    #if defined(MARTY_CONTAINERS_BYTE_SEARCH_AVX2) || defined(MARTY_CONTAINERS_BYTE_SEARCH_SSE2)
+
+    // SIMD byte compare is signed only, unsigned keys are biased by 0x80
+    const char bias = std::is_signed<KeyType>::value ? (char)0 : (char)0x80;
+    const char kb   = (char)((char)k ^ bias);
+
+    #if defined(MARTY_CONTAINERS_BYTE_SEARCH_AVX2)
+    {
+        const __m256i vk    = _mm256_set1_epi8(kb);
+        const __m256i vbias = _mm256_set1_epi8(bias);
+        for(; pos+32<=n; pos+=32)
+        {
+            __m256i v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(p+pos)), vbias);
+            std::uint32_t lessMask = (std::uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(vk, v));
+            if (lessMask!=0xFFFFFFFFu)
+                return pos + byte_search_impl::ctz32(~lessMask); // keys are sorted, so mask of less items is prefix
+        }
+    }
+    #endif
+
+    {
+        const __m128i vk    = _mm_set1_epi8(kb);
+        const __m128i vbias = _mm_set1_epi8(bias);
+        for(; pos+16<=n; pos+=16)
+        {
+            __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(p+pos)), vbias);
+            std::uint32_t lessMask = (std::uint32_t)_mm_movemask_epi8(_mm_cmplt_epi8(v, vk));
+            if (lessMask!=0xFFFFu)
+                return pos + byte_search_impl::ctz32(~lessMask);
+        }
+    }
+
+    #endif
+
+    return byte_search_impl::lower_bound_scalar(p, pos, n, k);
+}
+
+//----------------------------------------------------------------------------
+
+} // namespace containers
+} // namespace marty
+
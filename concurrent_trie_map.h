@@ -0,0 +1,286 @@
+/*! \file
+    \author Alexander Martynov (Marty AKA al-martyn1) <amart@mail.ru>
+    \copyright (c) 2014-2026 Alexander Martynov
+    \brief trie_map, разделённый на независимо блокируемые сегменты по первым элементам ключа
+
+    Repository: https://github.com/al-martyn1/marty_containers
+
+    Сегмент ключа выбирается по хэшу первых prefix_len элементов ключа, поэтому ключи с общим префиксом
+    этой длины попадают в один сегмент. Каждый сегмент - отдельный trie_map со своим std::shared_mutex:
+    поиск берёт разделяемую блокировку сегмента, изменение - исключительную, операции над разными
+    сегментами не мешают друг другу.
+
+    Упорядоченный обход (for_each) блокирует все сегменты на чтение и сливает их итераторы по порядку ключей.
+*/
+
+#pragma once
+
+#include "trie.h"
+//
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+// marty::containers::
+namespace marty {
+namespace containers {
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+template < typename KeyType
+         , typename ValueType
+         , typename Traits    = std::less< typename KeyType::value_type >
+         , typename IndexType = std::size_t
+         >
+class concurrent_trie_map
+{
+
+public: // types
+
+    typedef trie_map< KeyType, ValueType, Traits, IndexType >  map_type;
+
+    typedef typename map_type::key_type                        key_type;
+    typedef typename map_type::mapped_type                     mapped_type;
+    typedef typename map_type::value_type                      value_type;
+    typedef typename map_type::key_compare                     key_compare;
+    typedef typename map_type::size_type                       size_type;
+
+
+protected: // types
+
+    // own cache line for each shard lock
+    struct alignas(64) shard
+    {
+        mutable std::shared_mutex   mutex;
+        map_type                    map;
+    };
+
+    typedef std::shared_lock<std::shared_mutex>   read_lock;
+    typedef std::unique_lock<std::shared_mutex>   write_lock;
+
+
+protected: // member fields
+
+    size_type                    shards_size;
+    size_type                    prefix_len;
+    std::unique_ptr<shard[]>     shards;
+    key_compare                  comparator;
+
+
+public: // ctors
+
+    //! nShards - количество сегментов, prefixLen - количество первых элементов ключа, по которым выбирается сегмент
+    /*! Для текстовых ключей один первый символ даёт лишь несколько десятков различных значений,
+        поэтому по умолчанию используются два.
+     */
+    explicit
+    concurrent_trie_map( size_type nShards = 64, size_type prefixLen = 2, const key_compare &comp = key_compare() )
+    : shards_size(nShards ? nShards : 1)
+    , prefix_len(prefixLen ? prefixLen : 1)
+    , shards(new shard[nShards ? nShards : 1])
+    , comparator(comp)
+    {}
+
+    concurrent_trie_map( const concurrent_trie_map & ) = delete;
+    concurrent_trie_map& operator=( const concurrent_trie_map & ) = delete;
+
+
+public: // API
+
+    size_type get_shards_size() const { return shards_size; }
+
+    //! Вставляет v, если ключа нет; возвращает true, если ключ добавлен
+    bool insert( const value_type &v )
+    {
+        shard &s = get_shard(v.first);
+        write_lock lock(s.mutex);
+        if (s.map.find_value(v.first))
+            return false; // trie_map::insert replaces the value
+        s.map.insert(v);
+        return true;
+    }
+
+    //! Вставляет или заменяет значение, возвращает true, если ключ добавлен
+    bool insert_or_assign( const key_type &k, const mapped_type &v )
+    {
+        return upsert( k, v, []( mapped_type &cur, const mapped_type &nv ) { cur = nv; } );
+    }
+
+    //! Если ключа нет, вставляет v, иначе вызывает combiner(mapped_type &cur, const mapped_type &v) под блокировкой сегмента
+    /*! Возвращает true, если ключ добавлен. Например, подсчёт ключей:
+        m.upsert( k, 1, [](std::size_t &c, const std::size_t &d) { c += d; } );
+     */
+    template<typename Combiner>
+    bool upsert( const key_type &k, const mapped_type &v, Combiner combiner )
+    {
+        shard &s = get_shard(k);
+        write_lock lock(s.mutex);
+        mapped_type *pCur = s.map.find_value(k); // no iterator for the frequent update of existing key
+        if (pCur)
+        {
+            combiner( *pCur, v );
+            return false;
+        }
+        s.map.insert( value_type(k, v) );
+        return true;
+    }
+
+    //! Копирует значение по ключу в res, возвращает false, если ключа нет
+    bool find( const key_type &k, mapped_type &res ) const
+    {
+        const shard &s = get_shard(k);
+        read_lock lock(s.mutex);
+        const mapped_type *pVal = s.map.find_value(k);
+        if (!pVal)
+            return false;
+        res = *pVal;
+        return true;
+    }
+
+    size_type count( const key_type &k ) const
+    {
+        const shard &s = get_shard(k);
+        read_lock lock(s.mutex);
+        return s.map.count(k);
+    }
+
+    size_type erase( const key_type &k )
+    {
+        shard &s = get_shard(k);
+        write_lock lock(s.mutex);
+        return s.map.erase(k);
+    }
+
+    //! Сумма размеров сегментов; при параллельных изменениях - приблизительно
+    size_type size() const
+    {
+        size_type res = 0;
+        for(size_type i=0; i!=shards_size; ++i)
+        {
+            read_lock lock(shards[i].mutex);
+            res += shards[i].map.size();
+        }
+        return res;
+    }
+
+    bool empty() const { return size()==0; }
+
+    void clear()
+    {
+        for(size_type i=0; i!=shards_size; ++i)
+        {
+            write_lock lock(shards[i].mutex);
+            shards[i].map.clear();
+        }
+    }
+
+    //! Обход всех ключей по порядку: f(const key_type&, const mapped_type&)
+    /*! На время обхода все сегменты блокируются на чтение (в порядке индексов), поэтому обход видит
+        согласованное состояние; f не должна обращаться к изменяющим методам этого же объекта.
+     */
+    template<typename Visitor>
+    void for_each( Visitor f ) const;
+
+    //! Слияние всех сегментов в один trie_map
+    map_type to_map() const
+    {
+        map_type res;
+        for_each( [&res]( const key_type &k, const mapped_type &v ) { res.insert( value_type(k, v) ); } );
+        return res;
+    }
+
+
+protected: // impl helpers
+
+    size_type shard_index( const key_type &k ) const
+    {
+        // FNV-1a over hashes of the first prefix_len elements
+        std::uint64_t h = 14695981039346656037ull;
+        typename key_type::const_iterator it = k.begin();
+        for(size_type i=0; i!=prefix_len && it!=k.end(); ++i, ++it)
+        {
+            h ^= (std::uint64_t)std::hash<typename key_type::value_type>()(*it);
+            h *= 1099511628211ull;
+        }
+        return (size_type)(h % shards_size);
+    }
+
+    shard&       get_shard( const key_type &k )       { return shards[shard_index(k)]; }
+    const shard& get_shard( const key_type &k ) const { return shards[shard_index(k)]; }
+
+    bool key_less( const key_type &k1, const key_type &k2 ) const
+    {
+        return std::lexicographical_compare( k1.begin(), k1.end(), k2.begin(), k2.end(), comparator );
+    }
+
+}; // class concurrent_trie_map
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType >
+template<typename Visitor>
+inline void
+concurrent_trie_map<KeyType,ValueType,Traits,IndexType > :: for_each( Visitor f ) const
+{
+    typedef typename map_type::const_iterator   const_iterator;
+    typedef std::pair<const_iterator, size_type> heap_item; // position and shard index
+
+    // fixed lock order, so concurrent for_each calls do not deadlock with each other
+    std::vector<read_lock> locks;
+    locks.reserve(shards_size);
+    for(size_type i=0; i!=shards_size; ++i)
+        locks.emplace_back(shards[i].mutex);
+
+    // min-heap of current shard positions by key
+    auto greater = [this]( const heap_item &a, const heap_item &b ) { return key_less( b.first->first, a.first->first ); };
+
+    std::vector<heap_item> heap;
+    heap.reserve(shards_size);
+    for(size_type i=0; i!=shards_size; ++i)
+    {
+        const_iterator it = shards[i].map.begin();
+        if (it!=shards[i].map.end())
+            heap.push_back( heap_item(it, i) );
+    }
+    std::make_heap( heap.begin(), heap.end(), greater );
+
+    while(!heap.empty())
+    {
+        std::pop_heap( heap.begin(), heap.end(), greater );
+        heap_item &top = heap.back();
+
+        f( top.first->first, top.first->second );
+
+        ++top.first;
+        if (top.first==shards[top.second].map.end())
+        {
+            heap.pop_back();
+            continue;
+        }
+        std::push_heap( heap.begin(), heap.end(), greater );
+    }
+}
+
+//----------------------------------------------------------------------------
+
+} // namespace containers
+} // namespace marty
+
@@ -50,6 +50,77 @@ public: //ctors
 
 
 
+//----------------------------------------------------------------------------
+class trie_file_error : public std::runtime_error
+{
+
+public: //ctors
+
+    explicit trie_file_error(const std::string& message) 
+    : std::runtime_error(message)
+    {}
+
+    explicit trie_file_error(const char* message)
+        : std::runtime_error(message)
+    {}
+
+    trie_file_error() = delete;
+    trie_file_error(const trie_file_error &) = default;
+    trie_file_error(trie_file_error &&) = default;
+    trie_file_error& operator=(const trie_file_error &) = default;
+    trie_file_error& operator=(trie_file_error &&) = default;
+
+};
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+class index_overflow_error : public std::runtime_error
+{
+
+public: //ctors
+
+    explicit index_overflow_error(const std::string& message) 
+    : std::runtime_error(message)
+    {}
+
+    explicit index_overflow_error(const char* message)
+        : std::runtime_error(message)
+    {}
+
+    index_overflow_error() = delete;
+    index_overflow_error(const index_overflow_error &) = default;
+    index_overflow_error(index_overflow_error &&) = default;
+    index_overflow_error& operator=(const index_overflow_error &) = default;
+    index_overflow_error& operator=(index_overflow_error &&) = default;
+
+};
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+class pattern_syntax_error : public std::runtime_error
+{
+
+public: //ctors
+
+    explicit pattern_syntax_error(const std::string& message) 
+    : std::runtime_error(message)
+    {}
+
+    explicit pattern_syntax_error(const char* message)
+        : std::runtime_error(message)
+    {}
+
+    pattern_syntax_error() = delete;
+    pattern_syntax_error(const pattern_syntax_error &) = default;
+    pattern_syntax_error(pattern_syntax_error &&) = default;
+    pattern_syntax_error& operator=(const pattern_syntax_error &) = default;
+    pattern_syntax_error& operator=(pattern_syntax_error &&) = default;
+
+};
 //----------------------------------------------------------------------------
 
 } // namespace contyainers
@@ -0,0 +1,521 @@
+/*! \file
+    \author Alexander Martynov (Marty AKA al-martyn1) <amart@mail.ru>
+    \copyright (c) 2014-2026 Alexander Martynov
+    \brief Замороженный (read-only) trie в виде double-array (BASE/CHECK), компилируется из marty::containers::trie
+
+    Repository: https://github.com/al-martyn1/marty_containers
+
+    Переход по элементу ключа - O(1): t = base[s] + code(k), переход валиден, если check[t]==s.
+    Для целочисленных ключей размером до двух байт (и std::less/std::greater в качестве Traits)
+    код элемента ключа вычисляется напрямую, для остальных типов ключей используется
+    отсортированный алфавит всех встреченных в trie элементов ключа.
+*/
+
+#pragma once
+
+#include "trie.h"
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+// marty::containers::
+namespace marty {
+namespace containers {
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+//! Кодирование элементов ключа для double-array. Код 0 не используется, коды начинаются с 1
+template < typename KeyType
+         , typename Traits
+         >
+struct frozen_trie_key_coder
+{
+    typedef KeyType      key_type;
+    typedef Traits       key_compare;
+
+    //! Прямое кодирование элементов ключа, без алфавита
+    static constexpr bool direct_codes =  std::is_integral<key_type>::value
+                                       && !std::is_same<key_type, bool>::value
+                                       && sizeof(key_type)<=2
+                                       && (  std::is_same<key_compare, std::less<key_type> >::value
+                                          || std::is_same<key_compare, std::greater<key_type> >::value
+                                          );
+
+    template<typename IndexType>
+    static IndexType encode( const key_type &k, const key_type *pAlphabet, std::size_t alphabetSize, const key_compare &cmp )
+    {
+        return encode_impl<IndexType>( k, pAlphabet, alphabetSize, cmp, std::integral_constant<bool, direct_codes>() );
+    }
+
+    template<typename IndexType>
+    static key_type decode( IndexType c, const key_type *pAlphabet )
+    {
+        return decode_impl<IndexType>( c, pAlphabet, std::integral_constant<bool, direct_codes>() );
+    }
+
+protected:
+
+    template<typename IndexType>
+    static IndexType encode_impl( const key_type &k, const key_type *, std::size_t, const key_compare &, std::true_type )
+    {
+        typedef typename std::make_unsigned<key_type>::type unsigned_key_type;
+        return static_cast<IndexType>(static_cast<IndexType>(static_cast<unsigned_key_type>(k)) + 1);
+    }
+
+    template<typename IndexType>
+    static IndexType encode_impl( const key_type &k, const key_type *pAlphabet, std::size_t alphabetSize, const key_compare &cmp, std::false_type )
+    {
+        const key_type *pEnd = pAlphabet + alphabetSize;
+        const key_type *pFound = std::lower_bound(pAlphabet, pEnd, k, cmp);
+        if (pFound==pEnd || cmp(k, *pFound))
+            return static_cast<IndexType>(-1);
+        return static_cast<IndexType>(pFound - pAlphabet) + 1;
+    }
+
+    template<typename IndexType>
+    static key_type decode_impl( IndexType c, const key_type *, std::true_type )
+    {
+        typedef typename std::make_unsigned<key_type>::type unsigned_key_type;
+        return static_cast<key_type>(static_cast<unsigned_key_type>(c - 1));
+    }
+
+    template<typename IndexType>
+    static key_type decode_impl( IndexType c, const key_type *pAlphabet, std::false_type )
+    {
+        return pAlphabet[c - 1];
+    }
+
+}; // struct frozen_trie_key_coder
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+template < typename KeyType
+         , typename ValueType
+         , typename Traits = std::less< KeyType >
+         >
+class frozen_trie
+{
+
+public: // types
+
+    typedef KeyType                                   key_type;
+    typedef ValueType                                 mapped_type;
+    typedef Traits                                    key_compare;
+    typedef std::size_t                               size_type;
+
+    typedef trie< key_type, mapped_type, key_compare > trie_type;
+
+    typedef std::size_t                               state_index;
+    static constexpr state_index                      state_index_npos = static_cast<state_index>(-1);
+
+    typedef std::size_t                               value_index;
+    static constexpr value_index                      value_index_npos = static_cast<value_index>(-1);
+
+    typedef std::vector< state_index >                states_holder;
+    typedef std::vector< value_index >                state_values_holder;
+    typedef std::vector< mapped_type >                values_holder;
+    typedef std::vector< key_type >                   alphabet_holder;
+
+    typedef frozen_trie_key_coder< key_type, key_compare > key_coder;
+
+
+    //! Позиция в замороженном trie. Обхода (++/--) нет, только пошаговый спуск через find
+    class const_iterator
+    {
+        friend class frozen_trie;
+
+        const frozen_trie  *pTrie = 0;
+        state_index         state = state_index_npos;
+
+        const_iterator(const frozen_trie *pt, state_index s) : pTrie(pt), state(s) {}
+
+    public:
+
+        const_iterator() = default;
+        const_iterator(const const_iterator &) = default;
+        const_iterator& operator=(const const_iterator &) = default;
+
+        bool is_end_iter() const { return state==state_index_npos; }
+
+        bool is_payloaded() const
+        {
+            return !is_end_iter() && pTrie->state_values[state]!=value_index_npos;
+        }
+
+        const mapped_type& payload() const
+        {
+            MARTY_ADT_TRIE_IMPL_ASSERT( is_payloaded() && "No payload" );
+            return pTrie->values[pTrie->state_values[state]];
+        }
+
+        state_index get_state() const { return state; }
+
+        bool operator==(const const_iterator &i) const { return state==i.state; }
+        bool operator!=(const const_iterator &i) const { return state!=i.state; }
+
+    }; // class const_iterator
+
+
+protected: // member fields
+
+    static constexpr bool direct_codes = key_coder::direct_codes;
+
+    key_compare                   comparator;
+    alphabet_holder               alphabet;     // used only if direct_codes is false
+    states_holder                 base;
+    states_holder                 check;
+    state_values_holder           state_values;
+    values_holder                 values;
+
+
+public: // ctors
+
+    frozen_trie()
+        : comparator()
+        , alphabet()
+        , base()
+        , check()
+        , state_values()
+        , values()
+        {}
+
+    template<typename TrieIndexType, typename TrieAllocator>
+    explicit frozen_trie( const trie<key_type,mapped_type,key_compare,TrieIndexType,TrieAllocator> &t )
+        : comparator(t.key_comp())
+        , alphabet()
+        , base()
+        , check()
+        , state_values()
+        , values()
+    {
+        build(t);
+    }
+
+    frozen_trie( const frozen_trie & ) = default;
+    frozen_trie( frozen_trie && ) = default;
+    frozen_trie& operator=( const frozen_trie & ) = default;
+    frozen_trie& operator=( frozen_trie && ) = default;
+
+    void swap( frozen_trie &t )
+    {
+        std::swap(comparator, t.comparator);
+        alphabet     .swap(t.alphabet    );
+        base         .swap(t.base        );
+        check        .swap(t.check       );
+        state_values .swap(t.state_values);
+        values       .swap(t.values      );
+    }
+
+    void clear()
+    {
+        alphabet    .clear();
+        base        .clear();
+        check       .clear();
+        state_values.clear();
+        values      .clear();
+    }
+
+    //! Перестраивает double-array по готовому trie
+    template<typename TrieIndexType, typename TrieAllocator>
+    void build( const trie<key_type,mapped_type,key_compare,TrieIndexType,TrieAllocator> &t );
+
+
+public: // read API, compatible with trie
+
+    key_compare key_comp( ) const { return comparator; }
+
+    bool empty() const { return values.empty(); }
+
+    size_type values_size() const { return values.size(); }
+
+    size_type states_size() const { return check.size(); }
+
+    const_iterator end() const { return const_iterator(this, state_index_npos); }
+
+    template<typename KeyIter>
+    const_iterator find( const KeyIter &b, const KeyIter &e ) const
+    {
+        return find( end(), b, e );
+    }
+
+    template<typename KeyIter>
+    const_iterator find( const_iterator findFrom, KeyIter b, const KeyIter &e ) const
+    {
+        if (b==e)
+            return end();
+
+        for(; b!=e; ++b)
+        {
+            findFrom = find( findFrom, *b );
+            if (findFrom.is_end_iter())
+                break;
+        }
+
+        return findFrom;
+    }
+
+    const_iterator find( key_type k ) const
+    {
+        return find( end(), k );
+    }
+
+    const_iterator find( const_iterator findFrom, key_type k ) const
+    {
+        // end iterator means "start from root"
+        return const_iterator(this, next_state( findFrom.is_end_iter() ? 0 : findFrom.state, k ));
+    }
+
+    bool is_payloaded( const const_iterator &i ) const { return i.is_payloaded(); }
+
+    const mapped_type& payload( const_iterator i ) const { return i.payload(); } //!< Получаем const ссылку на нагрузку
+
+    const alphabet_holder&      get_alphabet()     const { return alphabet;     }
+    const states_holder&        get_base()         const { return base;         }
+    const states_holder&        get_check()        const { return check;        }
+    const state_values_holder&  get_state_values() const { return state_values; }
+    const values_holder&        get_values()       const { return values;       }
+
+    size_type get_used_mem() const
+    {
+        return sizeof(alphabet_holder)      + alphabet.capacity()*sizeof(key_type)
+             + sizeof(states_holder)        + base.capacity()*sizeof(state_index)
+             + sizeof(states_holder)        + check.capacity()*sizeof(state_index)
+             + sizeof(state_values_holder)  + state_values.capacity()*sizeof(value_index)
+             + sizeof(values_holder)        + values.capacity()*sizeof(mapped_type)
+             ;
+    }
+
+
+protected: // impl helpers
+
+    state_index key_code( const key_type &k ) const
+    {
+        return key_coder::template encode<state_index>( k, alphabet.data(), alphabet.size(), comparator );
+    }
+
+    state_index next_state( state_index s, const key_type &k ) const
+    {
+        if (s>=base.size() || base[s]==state_index_npos)
+            return state_index_npos;
+
+        state_index c = key_code(k);
+        if (c==state_index_npos)
+            return state_index_npos;
+
+        state_index t = base[s] + c;
+        if (t>=check.size() || check[t]!=s)
+            return state_index_npos;
+
+        return t;
+    }
+
+    void grow_states( state_index newSize )
+    {
+        if (newSize<=check.size())
+            return;
+        base        .resize(newSize, state_index_npos);
+        check       .resize(newSize, state_index_npos);
+        state_values.resize(newSize, value_index_npos);
+    }
+
+    template<typename TrieIndexType, typename TrieAllocator>
+    void build_alphabet( const trie<key_type,mapped_type,key_compare,TrieIndexType,TrieAllocator> &t );
+
+}; // class frozen_trie
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+template < typename KeyType, typename ValueType, typename Traits >
+template<typename TrieIndexType, typename TrieAllocator>
+inline void
+frozen_trie<KeyType,ValueType,Traits > :: build_alphabet( const trie<KeyType,ValueType,Traits,TrieIndexType,TrieAllocator> &t )
+{
+    typedef trie<KeyType,ValueType,Traits,TrieIndexType,TrieAllocator>    src_trie_type;
+
+    alphabet.clear();
+    if (direct_codes)
+        return;
+
+    typename src_trie_type::trie_nodes_holder::const_iterator nIt = t.trie_nodes.begin();
+    for(; nIt!=t.trie_nodes.end(); ++nIt)
+    {
+        typename src_trie_type::trie_node_data_item_index idx = 0, s = nIt->keys_size();
+        for(; idx!=s; ++idx)
+            alphabet.push_back(nIt->get_data_item(&t, idx).key);
+    }
+
+    std::sort(alphabet.begin(), alphabet.end(), comparator);
+
+    // equivalent keys collapses to one alphabet entry
+    const key_compare &cmp = comparator;
+    alphabet.erase( std::unique( alphabet.begin(), alphabet.end()
+                               , [&cmp](const key_type &l, const key_type &r) { return !cmp(l,r) && !cmp(r,l); }
+                               )
+                  , alphabet.end()
+                  );
+    alphabet.shrink_to_fit();
+}
+
+//----------------------------------------------------------------------------
+template < typename KeyType, typename ValueType, typename Traits >
+template<typename TrieIndexType, typename TrieAllocator>
+inline void
+frozen_trie<KeyType,ValueType,Traits > :: build( const trie<KeyType,ValueType,Traits,TrieIndexType,TrieAllocator> &t )
+{
+    typedef trie<KeyType,ValueType,Traits,TrieIndexType,TrieAllocator>    src_trie_type;
+    typedef typename src_trie_type::trie_node_index            trie_node_index;
+    typedef typename src_trie_type::trie_node_data_item_index  trie_node_data_item_index;
+
+    clear();
+    comparator = t.key_comp();
+
+    // root state
+    grow_states(1);
+    check[0] = 0;
+
+    if (t.trie_nodes.empty() || !t.trie_nodes[0].keys_size())
+        return;
+
+    build_alphabet(t);
+    values.reserve(t.values_size());
+
+    // BFS over trie nodes; each trie node becomes the children set of one state
+    std::deque< std::pair<trie_node_index, state_index> > queue;
+    queue.push_back(std::make_pair(trie_node_index(0), state_index(0)));
+
+    std::vector<state_index> codes;
+
+    // free CHECK cells are linked in ascending order, so the base search does not rescan occupied cells
+    std::vector<state_index> freeNext(1, state_index_npos);
+    std::vector<state_index> freePrev(1, state_index_npos);
+    state_index freeHead = state_index_npos;
+    state_index freeTail = state_index_npos;
+
+    while(!queue.empty())
+    {
+        const trie_node_index nodeIdx = queue.front().first;
+        const state_index     s       = queue.front().second;
+        queue.pop_front();
+
+        const typename src_trie_type::trie_node &node = t.trie_nodes[nodeIdx];
+        const trie_node_data_item_index nodeSize = node.keys_size();
+
+        codes.clear();
+        state_index minCode = state_index_npos;
+        state_index maxCode = 0;
+        for(trie_node_data_item_index idx=0; idx!=nodeSize; ++idx)
+        {
+            state_index c = key_code(node.get_data_item(&t, idx).key);
+            MARTY_ADT_TRIE_IMPL_ASSERT( c!=state_index_npos && "key missing in alphabet" );
+            codes.push_back(c);
+            minCode = std::min(minCode, c);
+            maxCode = std::max(maxCode, c);
+        }
+
+        // lookup for the base where all the child cells are free, only bases placing minCode to a free cell are tried;
+        // cells beyond the current size are free too
+        state_index b = std::max(check.size(), minCode) - minCode;
+        for(state_index f=freeHead; f!=state_index_npos; f=freeNext[f])
+        {
+            if (f<minCode)
+                continue;
+
+            const state_index candidate = f - minCode;
+            std::vector<state_index>::const_iterator cIt = codes.begin();
+            for(; cIt!=codes.end(); ++cIt)
+            {
+                const state_index cell = candidate + *cIt;
+                if (cell<check.size() && check[cell]!=state_index_npos)
+                    break;
+            }
+            if (cIt==codes.end())
+            {
+                b = candidate;
+                break;
+            }
+        }
+
+        // new cells are appended to the free list
+        const state_index oldSize = check.size();
+        grow_states(b + maxCode + 1);
+        freeNext.resize(check.size(), state_index_npos);
+        freePrev.resize(check.size(), state_index_npos);
+        for(state_index cell=oldSize; cell!=check.size(); ++cell)
+        {
+            freePrev[cell] = freeTail;
+            if (freeTail==state_index_npos)
+                freeHead = cell;
+            else
+                freeNext[freeTail] = cell;
+            freeTail = cell;
+        }
+
+        base[s] = b;
+
+        for(trie_node_data_item_index idx=0; idx!=nodeSize; ++idx)
+        {
+            const typename src_trie_type::trie_node_data_item &item = node.get_data_item(&t, idx);
+            const state_index childState = b + codes[idx];
+            check[childState] = s;
+
+            // unlink used cell
+            if (freePrev[childState]==state_index_npos)
+                freeHead = freeNext[childState];
+            else
+                freeNext[freePrev[childState]] = freeNext[childState];
+            if (freeNext[childState]==state_index_npos)
+                freeTail = freePrev[childState];
+            else
+                freePrev[freeNext[childState]] = freePrev[childState];
+
+            if (item.value_idx!=src_trie_type::value_index_npos)
+            {
+                state_values[childState] = values.size();
+                values.push_back(t.values[item.value_idx]);
+            }
+
+            if (item.child_idx!=src_trie_type::trie_node_index_npos)
+                queue.push_back(std::make_pair(item.child_idx, childState));
+        }
+    }
+
+    base        .shrink_to_fit();
+    check       .shrink_to_fit();
+    state_values.shrink_to_fit();
+    values      .shrink_to_fit();
+}
+
+//----------------------------------------------------------------------------
+//! Компилирует готовый trie в read-only double-array представление
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator > inline
+frozen_trie<KeyType,ValueType,Traits> freeze( const trie<KeyType,ValueType,Traits,IndexType,Allocator> &t )
+{
+    return frozen_trie<KeyType,ValueType,Traits>(t);
+}
+
+//----------------------------------------------------------------------------
+
+} // namespace containers
+} // namespace marty
+
@@ -0,0 +1,762 @@
+/*! \file
+    \author Alexander Martynov (Marty AKA al-martyn1) <amart@mail.ru>
+    \copyright (c) 2014-2026 Alexander Martynov
+    \brief Бинарный формат файла для frozen_trie и чтение через отображение файла в память (mmap) без десериализации
+
+    Repository: https://github.com/al-martyn1/marty_containers
+
+    Файл не содержит указателей, только смещения от начала файла, поэтому может быть
+    отображён по любому адресу и разделён между несколькими процессами.
+
+    Структура файла (все секции выровнены на 8 байт):
+      frozen_trie_file_header
+      base          - uint32_t[states_count]
+      check         - uint32_t[states_count]
+      state_values  - uint32_t[states_count]
+      child_ranges  - uint32_t[states_count+1], дочерние состояния s: children[child_ranges[s]..child_ranges[s+1])
+      children      - uint32_t[children_count], дочерние состояния в порядке ключей
+      alphabet      - key_type[alphabet_count]
+      values        - mapped_type[values_count]
+
+    Порядок байт - родной для записавшей файл платформы, при несовпадении файл не открывается.
+
+    При открытии проверяются не только границы секций, но и их содержимое (индексы значений,
+    дочерние состояния и их коды), поэтому повреждённый файл не приводит к чтению за границами отображения.
+    Проверка - один линейный проход по массивам состояний.
+*/
+
+#pragma once
+
+#include "exceptions.h"
+#include "frozen_trie.h"
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(WIN32) || defined(_WIN32)
+    // no min/max macros and no rarely used APIs leak to the files including this header
+    #if !defined(NOMINMAX)
+        #define NOMINMAX
+        #define MARTY_CONTAINERS_FROZEN_TRIE_FILE_UNDEF_NOMINMAX
+    #endif
+    #if !defined(WIN32_LEAN_AND_MEAN)
+        #define WIN32_LEAN_AND_MEAN
+        #define MARTY_CONTAINERS_FROZEN_TRIE_FILE_UNDEF_WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+    #if defined(MARTY_CONTAINERS_FROZEN_TRIE_FILE_UNDEF_NOMINMAX)
+        #undef NOMINMAX
+        #undef MARTY_CONTAINERS_FROZEN_TRIE_FILE_UNDEF_NOMINMAX
+    #endif
+    #if defined(MARTY_CONTAINERS_FROZEN_TRIE_FILE_UNDEF_WIN32_LEAN_AND_MEAN)
+        #undef WIN32_LEAN_AND_MEAN
+        #undef MARTY_CONTAINERS_FROZEN_TRIE_FILE_UNDEF_WIN32_LEAN_AND_MEAN
+    #endif
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+// marty::containers::
+namespace marty {
+namespace containers {
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+struct frozen_trie_file_header
+{
+    char            signature[8];           // "MFTRIEDA"
+    std::uint32_t   version;
+    std::uint32_t   byte_order;             // 0x01020304 in the writer byte order
+    std::uint32_t   key_size;
+    std::uint32_t   value_size;
+    std::uint32_t   index_size;
+    std::uint32_t   flags;
+
+    std::uint64_t   states_count;
+    std::uint64_t   children_count;
+    std::uint64_t   alphabet_count;
+    std::uint64_t   values_count;
+
+    std::uint64_t   base_offset;
+    std::uint64_t   check_offset;
+    std::uint64_t   state_values_offset;
+    std::uint64_t   child_ranges_offset;
+    std::uint64_t   children_offset;
+    std::uint64_t   alphabet_offset;
+    std::uint64_t   values_offset;
+    std::uint64_t   file_size;
+
+    static constexpr std::uint32_t  current_version   = 1;
+    static constexpr std::uint32_t  byte_order_mark   = 0x01020304u;
+    static constexpr std::uint32_t  flag_direct_codes = 0x0001u;
+
+    static const char* get_signature() { return "MFTRIEDA"; }
+
+}; // struct frozen_trie_file_header
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+//! Read-only отображение файла в память
+class mapped_file
+{
+
+protected: // member fields
+
+    const void     *pData    = 0;
+    std::size_t     dataSize = 0;
+
+    #if defined(WIN32) || defined(_WIN32)
+    HANDLE          hFile    = INVALID_HANDLE_VALUE;
+    HANDLE          hMapping = 0;
+    #endif
+
+public: // ctors
+
+    mapped_file() = default;
+
+    explicit mapped_file(const std::string &fileName)
+    {
+        open(fileName);
+    }
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file& operator=(const mapped_file &) = delete;
+
+    mapped_file(mapped_file &&other) { swap(other); }
+    mapped_file& operator=(mapped_file &&other) { close(); swap(other); return *this; }
+
+    ~mapped_file() { close(); }
+
+    void swap(mapped_file &other)
+    {
+        std::swap(pData   , other.pData   );
+        std::swap(dataSize, other.dataSize);
+        #if defined(WIN32) || defined(_WIN32)
+        std::swap(hFile   , other.hFile   );
+        std::swap(hMapping, other.hMapping);
+        #endif
+    }
+
+public: // methods
+
+    bool is_open() const            { return pData!=0; }
+    const void* data() const        { return pData; }
+    std::size_t size() const        { return dataSize; }
+
+    void open(const std::string &fileName)
+    {
+        close();
+
+        #if defined(WIN32) || defined(_WIN32)
+
+        hFile = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+        if (hFile==INVALID_HANDLE_VALUE)
+            throw trie_file_error("marty::containers::mapped_file::open: failed to open file: " + fileName);
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart==0)
+        {
+            close();
+            throw trie_file_error("marty::containers::mapped_file::open: empty or unreadable file: " + fileName);
+        }
+
+        hMapping = CreateFileMappingA(hFile, 0, PAGE_READONLY, 0, 0, 0);
+        if (!hMapping)
+        {
+            close();
+            throw trie_file_error("marty::containers::mapped_file::open: failed to create file mapping: " + fileName);
+        }
+
+        pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        if (!pData)
+        {
+            close();
+            throw trie_file_error("marty::containers::mapped_file::open: failed to map file: " + fileName);
+        }
+
+        dataSize = static_cast<std::size_t>(fileSize.QuadPart);
+
+        #else
+
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd<0)
+            throw trie_file_error("marty::containers::mapped_file::open: failed to open file: " + fileName);
+
+        struct stat st;
+        if (::fstat(fd, &st)!=0 || st.st_size==0)
+        {
+            ::close(fd);
+            throw trie_file_error("marty::containers::mapped_file::open: empty or unreadable file: " + fileName);
+        }
+
+        void *p = ::mmap(0, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd); // mapping keeps the file referenced
+        if (p==MAP_FAILED)
+            throw trie_file_error("marty::containers::mapped_file::open: failed to map file: " + fileName);
+
+        pData    = p;
+        dataSize = static_cast<std::size_t>(st.st_size);
+
+        #endif
+    }
+
+    void close()
+    {
+        #if defined(WIN32) || defined(_WIN32)
+        if (pData)
+            UnmapViewOfFile(pData);
+        if (hMapping)
+            CloseHandle(hMapping);
+        if (hFile!=INVALID_HANDLE_VALUE)
+            CloseHandle(hFile);
+        hMapping = 0;
+        hFile    = INVALID_HANDLE_VALUE;
+        #else
+        if (pData)
+            ::munmap(const_cast<void*>(pData), dataSize);
+        #endif
+
+        pData    = 0;
+        dataSize = 0;
+    }
+
+}; // class mapped_file
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+namespace frozen_trie_file_impl {
+
+inline std::uint64_t align_offset(std::uint64_t offs)
+{
+    return (offs + 7u) & ~std::uint64_t(7u);
+}
+
+template<typename T> inline
+void write_section(std::ostream &os, std::uint64_t &curOffs, std::uint64_t sectionOffs, const T *pData, std::size_t count)
+{
+    static const char zeros[8] = { 0 };
+    MARTY_ADT_TRIE_IMPL_ASSERT( sectionOffs>=curOffs && (sectionOffs-curOffs)<8 && "invalid section offset" );
+    os.write(zeros, static_cast<std::streamsize>(sectionOffs-curOffs));
+    if (count)
+        os.write(reinterpret_cast<const char*>(pData), static_cast<std::streamsize>(count*sizeof(T)));
+    curOffs = sectionOffs + count*sizeof(T);
+}
+
+inline std::uint32_t to_file_index(std::size_t idx)
+{
+    if (idx==static_cast<std::size_t>(-1))
+        return static_cast<std::uint32_t>(-1);
+    if (idx>=static_cast<std::size_t>(static_cast<std::uint32_t>(-1)))
+        throw trie_file_error("marty::containers::write_frozen_trie: index does not fit into 32 bits");
+    return static_cast<std::uint32_t>(idx);
+}
+
+} // namespace frozen_trie_file_impl
+
+//----------------------------------------------------------------------------
+//! Записывает frozen_trie в поток в формате, пригодном для mapped_frozen_trie
+template < typename KeyType, typename ValueType, typename Traits > inline
+void write_frozen_trie( std::ostream &os, const frozen_trie<KeyType,ValueType,Traits> &ft )
+{
+    static_assert(std::is_trivially_copyable<KeyType  >::value, "frozen trie file requires trivially copyable key type");
+    static_assert(std::is_trivially_copyable<ValueType>::value, "frozen trie file requires trivially copyable value type");
+    static_assert(alignof(KeyType)<=8 && alignof(ValueType)<=8, "frozen trie file sections are aligned to 8 bytes");
+
+    typedef frozen_trie<KeyType,ValueType,Traits>  frozen_trie_type;
+    typedef typename frozen_trie_type::key_coder   key_coder;
+    using frozen_trie_file_impl::to_file_index;
+    using frozen_trie_file_impl::align_offset;
+
+    const std::size_t statesCount = ft.get_check().size();
+
+    std::vector<std::uint32_t> base(statesCount), check(statesCount), stateValues(statesCount);
+    for(std::size_t s=0; s!=statesCount; ++s)
+    {
+        base[s]        = to_file_index(ft.get_base()[s]);
+        check[s]       = to_file_index(ft.get_check()[s]);
+        stateValues[s] = to_file_index(ft.get_state_values()[s]);
+    }
+
+    // child ranges - counting sort of the states by parent, then by key inside each parent
+    std::vector<std::uint32_t> childRanges(statesCount+1, 0);
+    for(std::size_t t=1; t<statesCount; ++t)
+    {
+        if (check[t]!=static_cast<std::uint32_t>(-1))
+            ++childRanges[check[t]+1];
+    }
+    for(std::size_t s=0; s!=statesCount; ++s)
+        childRanges[s+1] += childRanges[s];
+
+    std::vector<std::uint32_t> children(childRanges[statesCount]);
+    {
+        std::vector<std::uint32_t> fillPos(childRanges.begin(), childRanges.end()-1);
+        for(std::size_t t=1; t<statesCount; ++t)
+        {
+            if (check[t]!=static_cast<std::uint32_t>(-1))
+                children[fillPos[check[t]]++] = static_cast<std::uint32_t>(t);
+        }
+    }
+
+    const KeyType *pAlphabet = ft.get_alphabet().data();
+    const Traits  cmp        = ft.key_comp();
+    for(std::size_t s=0; s!=statesCount; ++s)
+    {
+        const std::uint32_t b = base[s];
+        std::sort( children.begin()+childRanges[s], children.begin()+childRanges[s+1]
+                 , [&](std::uint32_t t1, std::uint32_t t2)
+                   {
+                       return cmp( key_coder::template decode<std::uint32_t>(t1-b, pAlphabet)
+                                 , key_coder::template decode<std::uint32_t>(t2-b, pAlphabet)
+                                 );
+                   }
+                 );
+    }
+
+    frozen_trie_file_header hdr;
+    std::memset(&hdr, 0, sizeof(hdr));
+    std::memcpy(hdr.signature, frozen_trie_file_header::get_signature(), sizeof(hdr.signature));
+    hdr.version             = frozen_trie_file_header::current_version;
+    hdr.byte_order          = frozen_trie_file_header::byte_order_mark;
+    hdr.key_size            = static_cast<std::uint32_t>(sizeof(KeyType));
+    hdr.value_size          = static_cast<std::uint32_t>(sizeof(ValueType));
+    hdr.index_size          = static_cast<std::uint32_t>(sizeof(std::uint32_t));
+    hdr.flags               = key_coder::direct_codes ? frozen_trie_file_header::flag_direct_codes : 0u;
+    hdr.states_count        = statesCount;
+    hdr.children_count      = children.size();
+    hdr.alphabet_count      = ft.get_alphabet().size();
+    hdr.values_count        = ft.get_values().size();
+
+    hdr.base_offset         = align_offset(sizeof(frozen_trie_file_header));
+    hdr.check_offset        = align_offset(hdr.base_offset         + statesCount*sizeof(std::uint32_t));
+    hdr.state_values_offset = align_offset(hdr.check_offset        + statesCount*sizeof(std::uint32_t));
+    hdr.child_ranges_offset = align_offset(hdr.state_values_offset + statesCount*sizeof(std::uint32_t));
+    hdr.children_offset     = align_offset(hdr.child_ranges_offset + childRanges.size()*sizeof(std::uint32_t));
+    hdr.alphabet_offset     = align_offset(hdr.children_offset     + children.size()*sizeof(std::uint32_t));
+    hdr.values_offset       = align_offset(hdr.alphabet_offset     + hdr.alphabet_count*sizeof(KeyType));
+    hdr.file_size           = hdr.values_offset + hdr.values_count*sizeof(ValueType);
+
+    os.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    std::uint64_t curOffs = sizeof(hdr);
+
+    using frozen_trie_file_impl::write_section;
+    write_section(os, curOffs, hdr.base_offset        , base.data()               , base.size()             );
+    write_section(os, curOffs, hdr.check_offset       , check.data()              , check.size()            );
+    write_section(os, curOffs, hdr.state_values_offset, stateValues.data()        , stateValues.size()      );
+    write_section(os, curOffs, hdr.child_ranges_offset, childRanges.data()        , childRanges.size()      );
+    write_section(os, curOffs, hdr.children_offset    , children.data()           , children.size()         );
+    write_section(os, curOffs, hdr.alphabet_offset    , ft.get_alphabet().data()  , ft.get_alphabet().size());
+    write_section(os, curOffs, hdr.values_offset      , ft.get_values().data()    , ft.get_values().size()  );
+
+    if (!os)
+        throw trie_file_error("marty::containers::write_frozen_trie: write failed");
+}
+
+//----------------------------------------------------------------------------
+template < typename KeyType, typename ValueType, typename Traits > inline
+void write_frozen_trie( const std::string &fileName, const frozen_trie<KeyType,ValueType,Traits> &ft )
+{
+    std::ofstream ofs(fileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!ofs)
+        throw trie_file_error("marty::containers::write_frozen_trie: failed to create file: " + fileName);
+    write_frozen_trie(ofs, ft);
+    ofs.close();
+    if (!ofs)
+        throw trie_file_error("marty::containers::write_frozen_trie: failed to write file: " + fileName);
+}
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+//! Frozen trie, читаемый непосредственно из отображённого в память файла (или любого блока памяти)
+template < typename KeyType
+         , typename ValueType
+         , typename Traits = std::less< KeyType >
+         >
+class mapped_frozen_trie
+{
+
+public: // types
+
+    typedef KeyType                                   key_type;
+    typedef ValueType                                 mapped_type;
+    typedef Traits                                    key_compare;
+    typedef std::size_t                               size_type;
+
+    typedef std::uint32_t                             state_index;
+    static constexpr state_index                      state_index_npos = static_cast<state_index>(-1);
+
+    typedef frozen_trie_key_coder< key_type, key_compare > key_coder;
+
+    //! Позиция в trie. Обхода (++/--) нет, только пошаговый спуск через find
+    class const_iterator
+    {
+        friend class mapped_frozen_trie;
+
+        const mapped_frozen_trie  *pTrie = 0;
+        state_index                state = state_index_npos;
+
+        const_iterator(const mapped_frozen_trie *pt, state_index s) : pTrie(pt), state(s) {}
+
+    public:
+
+        const_iterator() = default;
+        const_iterator(const const_iterator &) = default;
+        const_iterator& operator=(const const_iterator &) = default;
+
+        bool is_end_iter() const { return state==state_index_npos; }
+
+        bool is_payloaded() const
+        {
+            return !is_end_iter() && pTrie->pStateValues[state]!=state_index_npos;
+        }
+
+        const mapped_type& payload() const
+        {
+            MARTY_ADT_TRIE_IMPL_ASSERT( is_payloaded() && "No payload" );
+            return pTrie->pValues[pTrie->pStateValues[state]];
+        }
+
+        state_index get_state() const { return state; }
+
+        bool operator==(const const_iterator &i) const { return state==i.state; }
+        bool operator!=(const const_iterator &i) const { return state!=i.state; }
+
+    }; // class const_iterator
+
+
+protected: // member fields
+
+    mapped_file                    file;
+    key_compare                    comparator;
+
+    const frozen_trie_file_header *pHeader      = 0;
+    const state_index             *pBase        = 0;
+    const state_index             *pCheck       = 0;
+    const state_index             *pStateValues = 0;
+    const state_index             *pChildRanges = 0;
+    const state_index             *pChildren    = 0;
+    const key_type                *pAlphabet    = 0;
+    const mapped_type             *pValues      = 0;
+
+
+public: // ctors
+
+    mapped_frozen_trie() : file(), comparator() {}
+
+    explicit mapped_frozen_trie( const std::string &fileName, const key_compare &cmp = key_compare() )
+        : file(), comparator(cmp)
+    {
+        open(fileName);
+    }
+
+    mapped_frozen_trie(const mapped_frozen_trie &) = delete;
+    mapped_frozen_trie& operator=(const mapped_frozen_trie &) = delete;
+
+    //! Отображает файл в память и проверяет заголовок. Данные не копируются
+    void open( const std::string &fileName )
+    {
+        close();
+        file.open(fileName);
+        try
+        {
+            attach(file.data(), file.size());
+        }
+        catch(...)
+        {
+            file.close();
+            throw;
+        }
+    }
+
+    //! Использует уже загруженный (или отображённый) блок памяти, выровненный на 8 байт. Содержимое проверяется
+    void attach( const void *pData, std::size_t dataSize )
+    {
+        static_assert(std::is_trivially_copyable<KeyType  >::value, "frozen trie file requires trivially copyable key type");
+        static_assert(std::is_trivially_copyable<ValueType>::value, "frozen trie file requires trivially copyable value type");
+
+        reset_pointers();
+
+        const char *pBytes = static_cast<const char*>(pData);
+        const frozen_trie_file_header *pHdr = reinterpret_cast<const frozen_trie_file_header*>(pBytes);
+
+        if (!pData || dataSize<sizeof(frozen_trie_file_header))
+            throw trie_file_error("marty::containers::mapped_frozen_trie: file too small");
+        if (std::memcmp(pHdr->signature, frozen_trie_file_header::get_signature(), sizeof(pHdr->signature))!=0)
+            throw trie_file_error("marty::containers::mapped_frozen_trie: invalid signature");
+        if (pHdr->version!=frozen_trie_file_header::current_version)
+            throw trie_file_error("marty::containers::mapped_frozen_trie: unsupported version");
+        if (pHdr->byte_order!=frozen_trie_file_header::byte_order_mark)
+            throw trie_file_error("marty::containers::mapped_frozen_trie: byte order mismatch");
+        if (pHdr->key_size!=sizeof(key_type) || pHdr->value_size!=sizeof(mapped_type) || pHdr->index_size!=sizeof(state_index))
+            throw trie_file_error("marty::containers::mapped_frozen_trie: key, value or index size mismatch");
+        if (((pHdr->flags & frozen_trie_file_header::flag_direct_codes)!=0) != key_coder::direct_codes)
+            throw trie_file_error("marty::containers::mapped_frozen_trie: key coding mismatch");
+        if (pHdr->file_size>dataSize || pHdr->states_count==0)
+            throw trie_file_error("marty::containers::mapped_frozen_trie: truncated file");
+
+        check_section(pHdr, pHdr->base_offset        , pHdr->states_count      , sizeof(state_index));
+        check_section(pHdr, pHdr->check_offset       , pHdr->states_count      , sizeof(state_index));
+        check_section(pHdr, pHdr->state_values_offset, pHdr->states_count      , sizeof(state_index));
+        check_section(pHdr, pHdr->child_ranges_offset, pHdr->states_count+1    , sizeof(state_index));
+        check_section(pHdr, pHdr->children_offset    , pHdr->children_count    , sizeof(state_index));
+        check_section(pHdr, pHdr->alphabet_offset    , pHdr->alphabet_count    , sizeof(key_type));
+        check_section(pHdr, pHdr->values_offset      , pHdr->values_count      , sizeof(mapped_type));
+
+        pHeader      = pHdr;
+        pBase        = reinterpret_cast<const state_index*>(pBytes + pHdr->base_offset        );
+        pCheck       = reinterpret_cast<const state_index*>(pBytes + pHdr->check_offset       );
+        pStateValues = reinterpret_cast<const state_index*>(pBytes + pHdr->state_values_offset);
+        pChildRanges = reinterpret_cast<const state_index*>(pBytes + pHdr->child_ranges_offset);
+        pChildren    = reinterpret_cast<const state_index*>(pBytes + pHdr->children_offset    );
+        pAlphabet    = reinterpret_cast<const key_type*   >(pBytes + pHdr->alphabet_offset    );
+        pValues      = reinterpret_cast<const mapped_type*>(pBytes + pHdr->values_offset      );
+
+        try
+        {
+            check_states();
+        }
+        catch(...)
+        {
+            reset_pointers();
+            throw;
+        }
+    }
+
+    void close()
+    {
+        reset_pointers();
+        file.close();
+    }
+
+    bool is_open() const { return pHeader!=0; }
+
+
+public: // read API, compatible with frozen_trie
+
+    key_compare key_comp( ) const { return comparator; }
+
+    bool empty() const { return values_size()==0; }
+
+    size_type values_size() const { return pHeader ? static_cast<size_type>(pHeader->values_count) : 0; }
+
+    size_type states_size() const { return pHeader ? static_cast<size_type>(pHeader->states_count) : 0; }
+
+    const_iterator end() const { return const_iterator(this, state_index_npos); }
+
+    template<typename KeyIter>
+    const_iterator find( const KeyIter &b, const KeyIter &e ) const
+    {
+        return find( end(), b, e );
+    }
+
+    template<typename KeyIter>
+    const_iterator find( const_iterator findFrom, KeyIter b, const KeyIter &e ) const
+    {
+        if (b==e)
+            return end();
+
+        for(; b!=e; ++b)
+        {
+            findFrom = find( findFrom, *b );
+            if (findFrom.is_end_iter())
+                break;
+        }
+
+        return findFrom;
+    }
+
+    const_iterator find( key_type k ) const
+    {
+        return find( end(), k );
+    }
+
+    const_iterator find( const_iterator findFrom, key_type k ) const
+    {
+        // end iterator means "start from root"
+        return const_iterator(this, next_state( findFrom.is_end_iter() ? 0 : findFrom.state, k ));
+    }
+
+    bool is_payloaded( const const_iterator &i ) const { return i.is_payloaded(); }
+
+    const mapped_type& payload( const_iterator i ) const { return i.payload(); } //!< Получаем const ссылку на нагрузку
+
+    //! Есть ли ключи, начинающиеся с [b,e)
+    template<typename KeyIter>
+    bool has_prefix( const KeyIter &b, const KeyIter &e ) const
+    {
+        if (!is_open())
+            return false;
+        if (b==e)
+            return !empty();
+        return !find(b, e).is_end_iter();
+    }
+
+    /*! Вызывает handler(const std::vector<key_type> &key, const mapped_type &val) для всех ключей,
+        начинающихся с [b,e), в порядке возрастания ключей. Пустой префикс - все ключи
+     */
+    template<typename KeyIter, typename Handler>
+    void for_each_prefixed( KeyIter b, const KeyIter &e, Handler handler ) const
+    {
+        if (!is_open())
+            return;
+
+        std::vector<key_type> key;
+        state_index s = 0;
+        for(; b!=e; ++b)
+        {
+            s = next_state(s, *b);
+            if (s==state_index_npos)
+                return;
+            key.push_back(*b);
+        }
+
+        if (s!=0 && pStateValues[s]!=state_index_npos)
+            handler(const_cast<const std::vector<key_type>&>(key), pValues[pStateValues[s]]);
+
+        for_each_prefixed_impl(s, key, handler);
+    }
+
+
+protected: // impl helpers
+
+    void reset_pointers()
+    {
+        pHeader      = 0;
+        pBase        = 0;
+        pCheck       = 0;
+        pStateValues = 0;
+        pChildRanges = 0;
+        pChildren    = 0;
+        pAlphabet    = 0;
+        pValues      = 0;
+    }
+
+    static void check_section( const frozen_trie_file_header *pHdr, std::uint64_t offs, std::uint64_t count, std::size_t itemSize )
+    {
+        if ((offs%8)!=0 || offs<sizeof(frozen_trie_file_header) || offs>pHdr->file_size)
+            throw trie_file_error("marty::containers::mapped_frozen_trie: invalid section offset");
+        if (count>(pHdr->file_size-offs)/itemSize)
+            throw trie_file_error("marty::containers::mapped_frozen_trie: section out of file bounds");
+    }
+
+    // largest valid key code, codes start from 1
+    std::uint64_t max_code() const
+    {
+        if (key_coder::direct_codes)
+            return std::uint64_t(1) << (8*sizeof(key_type));
+        return pHeader->alphabet_count;
+    }
+
+    // all indexes read from the file later are verified here, so lookups and traversals stay inside the sections
+    void check_states() const
+    {
+        const std::uint64_t statesCount = pHeader->states_count;
+        const std::uint64_t maxCode     = max_code();
+
+        if (pCheck[0]!=0)
+            throw trie_file_error("marty::containers::mapped_frozen_trie: invalid root state");
+
+        if (pChildRanges[0]!=0)
+            throw trie_file_error("marty::containers::mapped_frozen_trie: invalid child ranges");
+
+        for(std::uint64_t s=0; s!=statesCount; ++s)
+        {
+            if (pStateValues[s]!=state_index_npos && pStateValues[s]>=pHeader->values_count)
+                throw trie_file_error("marty::containers::mapped_frozen_trie: state value index out of range");
+
+            if (pCheck[s]!=state_index_npos && pCheck[s]>=statesCount)
+                throw trie_file_error("marty::containers::mapped_frozen_trie: state parent out of range");
+
+            if (pChildRanges[s+1]<pChildRanges[s] || pChildRanges[s+1]>pHeader->children_count)
+                throw trie_file_error("marty::containers::mapped_frozen_trie: invalid child ranges");
+
+            // child t of s is base[s]+code; check[t]==s and t!=0 make the traversal from root acyclic
+            for(state_index i=pChildRanges[s]; i!=pChildRanges[s+1]; ++i)
+            {
+                const state_index t = pChildren[i];
+                if (t==0 || t>=statesCount || pCheck[t]!=s || pBase[s]==state_index_npos || t<=pBase[s] || t-pBase[s]>maxCode)
+                    throw trie_file_error("marty::containers::mapped_frozen_trie: invalid child state");
+            }
+        }
+    }
+
+    state_index next_state( state_index s, const key_type &k ) const
+    {
+        if (!pHeader || pBase[s]==state_index_npos)
+            return state_index_npos;
+
+        state_index c = key_coder::template encode<state_index>( k, pAlphabet, static_cast<std::size_t>(pHeader->alphabet_count), comparator );
+        if (c==state_index_npos)
+            return state_index_npos;
+
+        std::uint64_t t = std::uint64_t(pBase[s]) + c;
+        if (t>=pHeader->states_count || pCheck[t]!=s)
+            return state_index_npos;
+
+        return static_cast<state_index>(t);
+    }
+
+    // preorder walk with explicit stack of (state, next child position), key follows the stack
+    template<typename Handler>
+    void for_each_prefixed_impl( state_index s, std::vector<key_type> &key, Handler &handler ) const
+    {
+        typedef std::pair<state_index, state_index> walk_position;
+
+        std::vector<walk_position> stack;
+        stack.push_back(walk_position(s, pChildRanges[s]));
+
+        while(!stack.empty())
+        {
+            walk_position &p = stack.back();
+            if (p.second==pChildRanges[p.first+1])
+            {
+                stack.pop_back();
+                if (!stack.empty())
+                    key.pop_back();
+                continue;
+            }
+
+            const state_index parent = p.first;
+            const state_index t      = pChildren[p.second++];
+            key.push_back(key_coder::template decode<state_index>(t - pBase[parent], pAlphabet));
+            if (pStateValues[t]!=state_index_npos)
+                handler(const_cast<const std::vector<key_type>&>(key), pValues[pStateValues[t]]);
+            stack.push_back(walk_position(t, pChildRanges[t])); // p is invalidated here
+        }
+    }
+
+}; // class mapped_frozen_trie
+
+//----------------------------------------------------------------------------
+
+} // namespace containers
+} // namespace marty
+
@@ -0,0 +1,241 @@
+/*! \file
+    \author Alexander Martynov (Marty AKA al-martyn1) <amart@mail.ru>
+    \copyright (c) 2014-2026 Alexander Martynov
+    \brief Параллельный поиск ключей trie в большом буфере (автомат Ахо-Корасик, разбиение на фрагменты)
+
+    Repository: https://github.com/al-martyn1/marty_containers
+
+    Буфер делится на фрагменты, фрагменты обрабатываются пулом потоков. Автомат и trie только читаются,
+    поэтому разделяются потоками без синхронизации. Каждый фрагмент просматривается с перекрытием
+    в max_depth()-1 элементов перед его началом, так что вхождения, пересекающие границу фрагментов,
+    находятся; вхождение относится к тому фрагменту, в котором оно заканчивается.
+    Обработчик вызывается в вызывающем потоке, вхождения сообщаются в том же порядке, что и aho_corasick::scan,
+    по мере готовности фрагментов; потоки не уходят вперёд доставленного фрагмента больше чем на 2*nThreads фрагментов,
+    так что в памяти ждут обработчика вхождения не более чем 2*nThreads фрагментов.
+*/
+
+#pragma once
+
+#include "aho_corasick.h"
+//
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//----------------------------------------------------------------------------
+// MARTY_CONTAINERS_PARALLEL_SCAN_MIN_CHUNK_SIZE - минимальный размер фрагмента при автоматическом выборе
+
+#if !defined(MARTY_CONTAINERS_PARALLEL_SCAN_MIN_CHUNK_SIZE)
+    #define MARTY_CONTAINERS_PARALLEL_SCAN_MIN_CHUNK_SIZE 65536
+#endif
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+// marty::containers::
+namespace marty {
+namespace containers {
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+//! Параллельный поиск всех вхождений ключей автомата в [b,e)
+/*! KeyIter - итератор произвольного доступа.
+    h(offset, length, value) вызывается в вызывающем потоке, как только готовы все предыдущие фрагменты.
+    nThreads==0 - по числу аппаратных потоков, chunkSize==0 - выбирается автоматически.
+    Возвращает количество найденных вхождений.
+ */
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator
+         , typename KeyIter, typename Handler
+         >
+inline
+std::size_t parallel_scan( const aho_corasick<KeyType,ValueType,Traits,IndexType,Allocator> &ac
+                         , KeyIter b, KeyIter e, Handler h
+                         , std::size_t nThreads = 0, std::size_t chunkSize = 0
+                         )
+{
+    typedef aho_corasick<KeyType,ValueType,Traits,IndexType,Allocator>   automaton_type;
+    typedef typename automaton_type::match                     match_type;
+    typedef typename automaton_type::scan_state                scan_state_type;
+
+    const std::size_t total = (std::size_t)std::distance(b, e);
+
+    if (!nThreads)
+        nThreads = std::max( (std::size_t)std::thread::hardware_concurrency(), (std::size_t)1 );
+
+    if (!chunkSize)
+        chunkSize = std::max( (std::size_t)MARTY_CONTAINERS_PARALLEL_SCAN_MIN_CHUNK_SIZE, total/(nThreads*4) + 1 );
+
+    const std::size_t nChunks = (total + chunkSize - 1) / chunkSize;
+
+    if (nThreads<2 || nChunks<2)
+        return ac.scan( b, e, [&h](std::size_t o, std::size_t l, const ValueType &v) { h(o, l, v); } );
+
+    nThreads = std::min(nThreads, nChunks);
+
+    // the longest match ending in the chunk starts at most max_depth()-1 elements before it
+    const std::size_t overlap = ac.max_depth() ? ac.max_depth()-1 : 0;
+
+    // chunks are claimed in order, and no chunk is claimed further than window chunks ahead of the delivered one,
+    // so at most window chunk results wait for the handler
+    const std::size_t window = nThreads*2;
+
+    std::vector< std::vector<match_type> > slots(window); // chunk i results are stored in slots[i%window]
+    std::vector<char>         slotReady(window, 0);
+    std::size_t               nextChunk = 0;
+    std::size_t               delivered = 0;
+    bool                      bStop     = false;
+    std::exception_ptr        firstError;
+    std::mutex                mutex;
+    std::condition_variable   cv;
+
+    auto scanChunk = [&]( std::size_t i, std::vector<match_type> &matches )
+    {
+        const std::size_t chunkBegin = i*chunkSize;
+        const std::size_t chunkEnd   = std::min(chunkBegin + chunkSize, total);
+        const std::size_t scanBegin  = chunkBegin>overlap ? chunkBegin-overlap : 0;
+
+        scan_state_type st;
+        st.offset = scanBegin;
+        ac.scan( st, b + scanBegin, b + chunkEnd
+               , [&](std::size_t o, std::size_t l, const ValueType &v)
+                 {
+                     if (o+l>chunkBegin) // matches ending in the overlap belongs to previous chunk
+                         matches.push_back( match_type{ o, l, &v } );
+                 }
+               );
+    };
+
+    // called with the mutex locked
+    auto canClaim = [&]() { return nextChunk<nChunks && nextChunk<delivered+window; };
+
+    auto worker = [&]()
+    {
+        try
+        {
+            for(;;)
+            {
+                std::size_t i = 0;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait( lock, [&]() { return bStop || nextChunk>=nChunks || canClaim(); } );
+                    if (bStop || nextChunk>=nChunks)
+                        return;
+                    i = nextChunk++;
+                }
+
+                std::vector<match_type> matches;
+                scanChunk(i, matches);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    slots[i%window].swap(matches);
+                    slotReady[i%window] = 1;
+                }
+                cv.notify_all();
+            }
+        }
+        catch(...)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!firstError)
+                    firstError = std::current_exception();
+                bStop = true; // stop other workers and the delivery
+            }
+            cv.notify_all();
+        }
+    };
+
+    // stops and joins started workers on any exit - normal, failed thread start or exception from the handler
+    struct workers_guard
+    {
+        std::vector<std::thread>  &threads;
+        std::mutex                &mutex;
+        std::condition_variable   &cv;
+        bool                      &bStop;
+
+        ~workers_guard()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                bStop = true;
+            }
+            cv.notify_all();
+            for(std::vector<std::thread>::iterator tIt=threads.begin(); tIt!=threads.end(); ++tIt)
+                tIt->join();
+        }
+    };
+
+    std::size_t nMatches = 0;
+
+    {
+        std::vector<std::thread> threads;
+        workers_guard guard = { threads, mutex, cv, bStop };
+
+        threads.reserve(nThreads-1);
+        for(std::size_t t=1; t!=nThreads; ++t)
+            threads.emplace_back(worker);
+
+        // calling thread delivers ready chunks in order and scans chunks itself while the next one is not ready
+        std::vector<match_type> matches;
+        std::unique_lock<std::mutex> lock(mutex);
+        while(delivered!=nChunks && !bStop)
+        {
+            const std::size_t slot = delivered%window;
+            if (slotReady[slot])
+            {
+                matches.clear();
+                matches.swap(slots[slot]);
+                slotReady[slot] = 0;
+                ++delivered;
+                lock.unlock();
+                cv.notify_all();
+
+                typename std::vector<match_type>::const_iterator mIt = matches.begin();
+                for(; mIt!=matches.end(); ++mIt)
+                    h( mIt->offset, mIt->length, *mIt->value );
+                nMatches += matches.size();
+
+                lock.lock();
+            }
+            else if (canClaim())
+            {
+                const std::size_t i = nextChunk++;
+                lock.unlock();
+
+                std::vector<match_type> chunkMatches;
+                scanChunk(i, chunkMatches); // exception leaves the loop, guard stops the workers
+
+                lock.lock();
+                slots[i%window].swap(chunkMatches);
+                slotReady[i%window] = 1;
+            }
+            else
+            {
+                cv.wait(lock);
+            }
+        }
+    }
+
+    if (firstError)
+        std::rethrow_exception(firstError);
+
+    return nMatches;
+}
+
+//----------------------------------------------------------------------------
+
+} // namespace containers
+} // namespace marty
+
@@ -0,0 +1,436 @@
+/*! \file
+    \author Alexander Martynov (Marty AKA al-martyn1) <amart@mail.ru>
+    \copyright (c) 2014-2026 Alexander Martynov
+    \brief Персистентный (неизменяемый) trie_map: изменение возвращает новую версию, разделяющую неизменённые узлы со старой
+
+    Repository: https://github.com/al-martyn1/marty_containers
+
+    В отличие от marty::containers::trie, узлы которого адресуются индексами в общих векторах,
+    здесь каждый узел - отдельный неизменяемый объект, на который ссылаются через std::shared_ptr.
+    Вставка и удаление копируют только узлы на пути ключа (O(глубина) узлов), все остальные узлы
+    новая версия разделяет со старой. Копирование версии (снимок) - копирование одного указателя, O(1).
+
+    Версии не изменяются, поэтому одну версию можно читать из нескольких потоков без синхронизации;
+    счётчики ссылок std::shared_ptr атомарны, так что версии можно создавать и освобождать в разных потоках.
+*/
+
+#pragma once
+
+#include "trie.h"
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+// marty::containers::
+namespace marty {
+namespace containers {
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+template < typename KeyType
+         , typename ValueType
+         , typename Traits    = std::less< typename KeyType::value_type >
+         >
+class persistent_trie_map
+{
+
+public: // types
+
+    typedef KeyType                                   key_type;
+    typedef typename KeyType::value_type              key_element_type;
+    typedef ValueType                                 mapped_type;
+    typedef Traits                                    key_compare;
+    typedef std::size_t                               size_type;
+    typedef std::ptrdiff_t                            difference_type;
+
+    typedef ref_pair<const key_type, const mapped_type>   ref_pair_type;
+
+
+protected: // types
+
+    struct node;
+
+    typedef std::shared_ptr<const node>               node_ptr;
+    typedef std::shared_ptr<const mapped_type>        value_ptr; // values are shared too, path copy does not copy them
+
+    struct node_item
+    {
+        key_element_type   key;
+        node_ptr           child; // null - no continuations
+        value_ptr          value; // null - no payload
+    };
+
+    typedef std::vector<node_item>                    node_items_holder;
+
+    // node is never empty, empty subtrees are represented by null pointer
+    struct node
+    {
+        node_items_holder  items;
+
+        node() : items() {}
+        node( const node &n ) : items(n.items) {}
+
+        // childs owned by this node only are unlinked through explicit stack, so dropping
+        // a version with long keys does not recurse through shared_ptr destructors
+        ~node()
+        {
+            std::vector<node_ptr> stack;
+            take_childs( items, stack );
+            while(!stack.empty())
+            {
+                node_ptr p = std::move(stack.back());
+                stack.pop_back();
+                if (p.use_count()!=1)
+                    continue; // shared with other version, only reference released
+                std::atomic_thread_fence(std::memory_order_acquire); // pairs with release of other owners
+                take_childs( const_cast<node&>(*p).items, stack ); // sole owner, node is not const object
+            }
+        }
+
+        static void take_childs( node_items_holder &items, std::vector<node_ptr> &stack )
+        {
+            for(typename node_items_holder::iterator it=items.begin(); it!=items.end(); ++it)
+                if (it->child)
+                    stack.push_back(std::move(it->child));
+        }
+    };
+
+    // copy of path node and index of key item in it
+    typedef std::pair<std::shared_ptr<node>, size_type>   path_node;
+
+
+public: // iterator
+
+    //! Прямой итератор по ключам с полезной нагрузкой в порядке key_compare; держит свою версию
+    class const_iterator
+    {
+        friend class persistent_trie_map;
+
+        typedef std::pair<const node*, size_type>    position;
+
+        node_ptr                 root; // keeps traversed version alive
+        std::vector<position>    path;
+        key_type                 key;
+
+        const node_item& get_item() const { return path.back().first->items[path.back().second]; }
+
+        // next position in preorder, payloaded or not
+        void step()
+        {
+            const node_item &item = get_item();
+            if (item.child)
+            {
+                path.push_back(position(item.child.get(), 0));
+                key.push_back(item.child->items[0].key);
+                return;
+            }
+
+            while(!path.empty())
+            {
+                key.pop_back();
+                position &p = path.back();
+                if (++p.second < p.first->items.size())
+                {
+                    key.push_back(p.first->items[p.second].key);
+                    return;
+                }
+                path.pop_back();
+            }
+        }
+
+        void move_to_payloaded()
+        {
+            while(!path.empty() && !get_item().value)
+                step();
+        }
+
+    public:
+
+        typedef std::forward_iterator_tag    iterator_category;
+        typedef ref_pair_type                value_type;
+        typedef std::ptrdiff_t               difference_type;
+        typedef boxed_ptr<ref_pair_type>     pointer;
+        typedef ref_pair_type                reference;
+
+        const_iterator() : root(), path(), key() {}
+
+        bool is_end_iter() const { return path.empty(); }
+
+        const key_type&    get_key() const   { return key; }
+        const mapped_type& get_value() const { return *get_item().value; }
+
+        reference operator*() const  { return ref_pair_type(key, get_value()); }
+        pointer   operator->() const { return pointer(ref_pair_type(key, get_value())); }
+
+        const_iterator& operator++()
+        {
+            step();
+            move_to_payloaded();
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator res = *this;
+            ++*this;
+            return res;
+        }
+
+        bool operator==( const const_iterator &it ) const
+        {
+            if (path.empty() || it.path.empty())
+                return path.empty() && it.path.empty();
+            return path.back()==it.path.back();
+        }
+
+        bool operator!=( const const_iterator &it ) const { return !operator==(it); }
+
+    }; // class const_iterator
+
+
+protected: // member fields
+
+    node_ptr       root;
+    size_type      values_size;
+    key_compare    comparator;
+
+
+public: // ctors
+
+    persistent_trie_map() : root(), values_size(0), comparator() {}
+
+    explicit
+    persistent_trie_map( const key_compare &comp ) : root(), values_size(0), comparator(comp) {}
+
+    //! Снимок, O(1)
+    persistent_trie_map( const persistent_trie_map & ) = default;
+    persistent_trie_map( persistent_trie_map && ) = default;
+    persistent_trie_map& operator=( const persistent_trie_map & ) = default;
+    persistent_trie_map& operator=( persistent_trie_map && ) = default;
+
+    //! Строит версию из последовательности пар ключ/значение
+    template<class InputIterator>
+    persistent_trie_map( InputIterator f, InputIterator l, const key_compare &comp = key_compare() )
+    : root(), values_size(0), comparator(comp)
+    {
+        for(; f!=l; ++f)
+            *this = insert_or_assign( f->first, f->second );
+    }
+
+    void swap( persistent_trie_map &m )
+    {
+        root.swap(m.root);
+        std::swap(values_size, m.values_size);
+        std::swap(comparator, m.comparator);
+    }
+
+
+public: // read API
+
+    size_type size() const  { return values_size; }
+    bool      empty() const { return values_size==0; }
+
+    key_compare key_comp() const { return comparator; }
+
+    //! true, если версии разделяют корень, то есть совпадают
+    bool is_same_version( const persistent_trie_map &m ) const { return root==m.root; }
+
+    template<typename KeyIter>
+    const mapped_type* find_value( KeyIter b, const KeyIter &e ) const
+    {
+        if (b==e)
+            return 0;
+
+        const node *pNode = root.get();
+        while(pNode)
+        {
+            const node_item *pItem = find_item( *pNode, *b );
+            if (!pItem)
+                return 0;
+            if (++b==e)
+                return pItem->value.get();
+            pNode = pItem->child.get();
+        }
+        return 0;
+    }
+
+    const mapped_type* find_value( const key_type &k ) const { return find_value( k.begin(), k.end() ); }
+
+    size_type count( const key_type &k ) const { return find_value(k) ? 1 : 0; }
+
+    const_iterator begin() const
+    {
+        const_iterator it;
+        if (!root)
+            return it;
+        it.root = root;
+        it.path.push_back(typename const_iterator::position(root.get(), 0));
+        it.key.push_back(root->items[0].key);
+        it.move_to_payloaded();
+        return it;
+    }
+
+    const_iterator end() const { return const_iterator(); }
+
+    const_iterator find( const key_type &k ) const
+    {
+        const_iterator it;
+        if (!root || k.begin()==k.end())
+            return it;
+
+        it.root = root;
+        const node *pNode = root.get();
+        for(typename key_type::const_iterator b=k.begin(); b!=k.end(); ++b)
+        {
+            if (!pNode)
+                return const_iterator();
+
+            typename node_items_holder::const_iterator itemIt = lower_bound_item( *pNode, *b );
+            if (itemIt==pNode->items.end() || comparator(*b, itemIt->key))
+                return const_iterator();
+
+            it.path.push_back(typename const_iterator::position(pNode, (size_type)(itemIt - pNode->items.begin())));
+            it.key.push_back(itemIt->key);
+            pNode = itemIt->child.get();
+        }
+
+        if (!it.get_item().value)
+            return const_iterator();
+        return it;
+    }
+
+
+public: // update API, returns new versions
+
+    //! Новая версия с ключом k и значением v; копируются только узлы на пути k
+    persistent_trie_map insert_or_assign( const key_type &k, const mapped_type &v ) const
+    {
+        MARTY_ADT_TRIE_IMPL_ASSERT( k.begin()!=k.end() && "can't insert empty sequence" );
+
+        persistent_trie_map res(comparator);
+        bool bNew = false;
+        res.root        = insert_impl( root.get(), k.begin(), k.end(), std::make_shared<const mapped_type>(v), bNew );
+        res.values_size = values_size + (bNew ? 1 : 0);
+        return res;
+    }
+
+    //! Новая версия без ключа k; если ключа нет, возвращается эта же версия
+    persistent_trie_map erase( const key_type &k ) const
+    {
+        if (!find_value(k))
+            return *this;
+
+        persistent_trie_map res(comparator);
+        res.root        = erase_impl( root, k.begin(), k.end() );
+        res.values_size = values_size - 1;
+        return res;
+    }
+
+    persistent_trie_map clear() const
+    {
+        return persistent_trie_map(comparator);
+    }
+
+
+protected: // impl helpers
+
+    typename node_items_holder::const_iterator lower_bound_item( const node &n, const key_element_type &k ) const
+    {
+        return std::lower_bound( n.items.begin(), n.items.end(), k
+                               , [this]( const node_item &item, const key_element_type &key ) { return comparator(item.key, key); }
+                               );
+    }
+
+    const node_item* find_item( const node &n, const key_element_type &k ) const
+    {
+        typename node_items_holder::const_iterator it = lower_bound_item( n, k );
+        if (it==n.items.end() || comparator(k, it->key))
+            return 0;
+        return &*it;
+    }
+
+    // copies nodes on the path of key [b, e), creates missing ones; returns copies top-down
+    template<typename KeyIter>
+    std::vector<path_node> copy_path( const node *pNode, KeyIter b, const KeyIter &e ) const
+    {
+        std::vector<path_node> path;
+        for(; b!=e; ++b)
+        {
+            std::shared_ptr<node> res = pNode ? std::make_shared<node>(*pNode) : std::make_shared<node>();
+
+            typename node_items_holder::iterator it = res->items.begin()
+                                                    + (lower_bound_item( *res, *b ) - res->items.cbegin());
+            if (it==res->items.end() || comparator(*b, it->key))
+            {
+                node_item item;
+                item.key = *b;
+                it = res->items.insert(it, item);
+            }
+
+            pNode = it->child.get(); // still owned by the copy
+            path.push_back(path_node(res, (size_type)(it - res->items.begin())));
+        }
+        return path;
+    }
+
+    template<typename KeyIter>
+    node_ptr insert_impl( const node *pNode, KeyIter b, const KeyIter &e, const value_ptr &v, bool &bNew ) const
+    {
+        std::vector<path_node> path = copy_path( pNode, b, e );
+
+        node_item &item = path.back().first->items[path.back().second];
+        bNew       = !item.value;
+        item.value = v;
+
+        // links copies bottom-up
+        for(size_type i=path.size()-1; i!=0; --i)
+            path[i-1].first->items[path[i-1].second].child = path[i].first;
+
+        return path.front().first;
+    }
+
+    // key must exist
+    template<typename KeyIter>
+    node_ptr erase_impl( const node_ptr &pNode, KeyIter b, const KeyIter &e ) const
+    {
+        std::vector<path_node> path = copy_path( pNode.get(), b, e );
+
+        path.back().first->items[path.back().second].value.reset();
+
+        // links copies bottom-up, items without payload and continuations are removed, empty nodes become null
+        node_ptr child = path.back().first->items[path.back().second].child;
+        for(size_type i=path.size(); i!=0; --i)
+        {
+            node &n = *path[i-1].first;
+            typename node_items_holder::iterator it = n.items.begin() + path[i-1].second;
+            it->child = child;
+
+            if (!it->value && !it->child)
+                n.items.erase(it);
+
+            child = n.items.empty() ? node_ptr() : node_ptr(path[i-1].first);
+        }
+
+        return child;
+    }
+
+}; // class persistent_trie_map
+
+//----------------------------------------------------------------------------
+
+} // namespace containers
+} // namespace marty
+
@@ -0,0 +1,821 @@
+/*! \file
+    \author Alexander Martynov (Marty AKA al-martyn1) <amart@mail.ru>
+    \copyright (c) 2014-2026 Alexander Martynov
+    \brief Radix (Patricia, path-compressed) trie map. Интерфейс аналогичен trie_map
+
+    Repository: https://github.com/al-martyn1/marty_containers
+
+    Цепочки узлов с единственным потомком хранятся как одно ребро с меткой (label).
+    Метки всех рёбер лежат в общем пуле labels, ребро хранит только позицию и длину метки,
+    поэтому разбиение ребра при вставке не копирует элементы ключа. При удалении узел
+    без нагрузки с единственным потомком сливается с родительским ребром.
+*/
+
+#pragma once
+
+#include "trie.h"
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+// marty::containers::
+namespace marty {
+namespace containers {
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+template < typename KeyType
+         , typename ValueType
+         , typename Traits = std::less< typename KeyType::value_type >
+         >
+class radix_trie_map
+{
+
+public: // types
+
+    typedef KeyType                                   key_type;
+    typedef ValueType                                 mapped_type;
+    typedef Traits                                    key_compare;
+    typedef typename KeyType::value_type              key_element_type;
+    typedef std::pair<KeyType,ValueType>              value_type;
+    typedef std::size_t                               size_type;
+    typedef std::ptrdiff_t                            difference_type;
+
+    typedef std::size_t                               node_index;
+    static constexpr node_index                       node_index_npos  = static_cast<node_index>(-1);
+
+    typedef std::size_t                               label_index;
+
+    typedef std::size_t                               value_index;
+    static constexpr value_index                      value_index_npos = static_cast<value_index>(-1);
+
+    struct radix_edge
+    {
+        label_index     label_pos;  // first label element in labels pool
+        size_type       label_len;
+        node_index      child_idx;
+
+        radix_edge(label_index p = 0, size_type l = 0, node_index c = node_index_npos)
+            : label_pos(p), label_len(l), child_idx(c)
+            {}
+    };
+
+    typedef std::vector< radix_edge >                 edges_holder;
+
+    struct radix_node
+    {
+        edges_holder    edges;      // sorted by the first label element
+        value_index     value_idx;
+
+        radix_node() : edges(), value_idx(value_index_npos) {}
+    };
+
+    struct radix_position
+    {
+        node_index      node_idx;   // parent node
+        size_type       edge_idx;   // edge in parent node
+
+        radix_position(node_index n = node_index_npos, size_type e = 0) : node_idx(n), edge_idx(e) {}
+
+        bool operator==(const radix_position &p) const { return node_idx==p.node_idx && edge_idx==p.edge_idx; }
+        bool operator!=(const radix_position &p) const { return !operator==(p); }
+    };
+
+    typedef std::vector< radix_node >                 nodes_holder;
+    typedef std::vector< key_element_type >           labels_holder;
+    typedef std::vector< mapped_type >                values_holder;
+    typedef std::vector< value_index >                value_free_index_holder;
+    typedef std::vector< node_index >                 node_free_index_holder;
+    typedef std::vector< radix_position >             positions_holder;
+
+
+    //------------------------------
+    template<typename MapType, typename RefPairType>
+    class iterator_base_impl
+    {
+        friend class radix_trie_map;
+
+    protected:
+
+        MapType             *pMap = 0;
+        positions_holder     curPos;  // empty for end iterator
+        key_type             str_key;
+
+        iterator_base_impl(MapType *pm) : pMap(pm), curPos(), str_key() {}
+
+        node_index get_node_index() const
+        {
+            MARTY_ADT_TRIE_IMPL_ASSERT( !curPos.empty() && "dereferencing end iterator" );
+            return pMap->get_edge(curPos.back()).child_idx;
+        }
+
+        mapped_type& get_value_ref() const
+        {
+            return const_cast<mapped_type&>(pMap->values[pMap->nodes[get_node_index()].value_idx]);
+        }
+
+        void push_pos( node_index nodeIdx, size_type edgeIdx )
+        {
+            curPos.push_back(radix_position(nodeIdx, edgeIdx));
+            const radix_edge &edge = pMap->get_edge(curPos.back());
+            str_key.insert( str_key.end()
+                          , pMap->labels.begin() + edge.label_pos
+                          , pMap->labels.begin() + edge.label_pos + edge.label_len
+                          );
+        }
+
+        void pop_pos()
+        {
+            MARTY_ADT_TRIE_IMPL_ASSERT( !curPos.empty() && "try to pop position on end iterator" );
+            const radix_edge &edge = pMap->get_edge(curPos.back());
+            str_key.erase( str_key.begin() + (str_key.size() - edge.label_len), str_key.end() );
+            curPos.pop_back();
+        }
+
+        bool is_payloaded() const
+        {
+            return !curPos.empty() && pMap->nodes[get_node_index()].value_idx!=value_index_npos;
+        }
+
+        // preorder: node first, then its children
+        void move_to_next_impl()
+        {
+            if (curPos.empty())
+                return;
+
+            node_index nodeIdx = get_node_index();
+            if (!pMap->nodes[nodeIdx].edges.empty())
+            {
+                push_pos(nodeIdx, 0);
+                return;
+            }
+
+            while(!curPos.empty())
+            {
+                radix_position pos = curPos.back();
+                pop_pos();
+                if (pos.edge_idx+1 < pMap->nodes[pos.node_idx].edges.size())
+                {
+                    push_pos(pos.node_idx, pos.edge_idx+1);
+                    return;
+                }
+            }
+        }
+
+        void move_to_last_in_subtree( node_index nodeIdx )
+        {
+            while(!pMap->nodes[nodeIdx].edges.empty())
+            {
+                size_type lastEdge = pMap->nodes[nodeIdx].edges.size()-1;
+                push_pos(nodeIdx, lastEdge);
+                nodeIdx = pMap->nodes[nodeIdx].edges[lastEdge].child_idx;
+            }
+        }
+
+        void move_to_prev_impl()
+        {
+            if (curPos.empty())
+            {
+                if (!pMap->nodes.empty())
+                    move_to_last_in_subtree(0);
+                return;
+            }
+
+            radix_position pos = curPos.back();
+            pop_pos();
+            if (pos.edge_idx==0)
+                return; // parent goes before its children
+
+            push_pos(pos.node_idx, pos.edge_idx-1);
+            move_to_last_in_subtree(get_node_index());
+        }
+
+        void move_to_next_payloaded_impl()
+        {
+            do{ move_to_next_impl(); } while(!curPos.empty() && !is_payloaded());
+        }
+
+        void move_to_prev_payloaded_impl()
+        {
+            do{ move_to_prev_impl(); } while(!curPos.empty() && !is_payloaded());
+        }
+
+        bool is_equal( const iterator_base_impl &i ) const
+        {
+            MARTY_ADT_TRIE_IMPL_ASSERT( pMap==i.pMap && "can't compare iterators from different containers" );
+            return curPos==i.curPos;
+        }
+
+    public:
+
+        typedef std::bidirectional_iterator_tag    iterator_category;
+        typedef RefPairType                        value_type;
+        typedef radix_trie_map::difference_type    difference_type;
+        typedef boxed_ptr< RefPairType >           pointer;
+        typedef RefPairType                        reference;
+
+        iterator_base_impl() = default;
+        iterator_base_impl(const iterator_base_impl &) = default;
+        iterator_base_impl& operator=(const iterator_base_impl &) = default;
+
+        bool is_end_iter() const { return curPos.empty(); }
+
+        const key_type& key() const { return str_key; }
+
+        boxed_ptr< RefPairType > operator->() const { return boxed_ptr< RefPairType >( RefPairType(str_key, get_value_ref()) ); }
+        RefPairType              operator* () const { return RefPairType(str_key, get_value_ref()); }
+
+    }; // class iterator_base_impl
+
+    //------------------------------
+    class iterator;
+
+    class const_iterator : public iterator_base_impl< const radix_trie_map, ref_pair<const key_type, const mapped_type> >
+    {
+        friend class radix_trie_map;
+        typedef iterator_base_impl< const radix_trie_map, ref_pair<const key_type, const mapped_type> > base_impl;
+
+        const_iterator(const radix_trie_map *pm) : base_impl(pm) {}
+
+    public:
+
+        const_iterator() = default;
+        const_iterator(const const_iterator &) = default;
+        const_iterator(const iterator &i) : base_impl(i.pMap) { this->curPos = i.curPos; this->str_key = i.str_key; }
+        const_iterator& operator=(const const_iterator &) = default;
+
+        const_iterator& operator++()   { this->move_to_next_payloaded_impl(); return *this; } // prefix
+        const_iterator  operator++(int){ const_iterator res(*this); this->move_to_next_payloaded_impl(); return res; } // suffix
+        const_iterator& operator--()   { this->move_to_prev_payloaded_impl(); return *this; } // prefix
+        const_iterator  operator--(int){ const_iterator res(*this); this->move_to_prev_payloaded_impl(); return res; } // suffix
+
+        bool operator==(const const_iterator &i) const { return this->is_equal(i); }
+        bool operator!=(const const_iterator &i) const { return !this->is_equal(i); }
+
+    }; // class const_iterator
+
+    class iterator : public iterator_base_impl< radix_trie_map, ref_pair<const key_type, mapped_type> >
+    {
+        friend class radix_trie_map;
+        friend class const_iterator;
+        typedef iterator_base_impl< radix_trie_map, ref_pair<const key_type, mapped_type> > base_impl;
+
+        iterator(radix_trie_map *pm) : base_impl(pm) {}
+
+    public:
+
+        iterator() = default;
+        iterator(const iterator &) = default;
+        iterator& operator=(const iterator &) = default;
+
+        iterator& operator++()   { this->move_to_next_payloaded_impl(); return *this; } // prefix
+        iterator  operator++(int){ iterator res(*this); this->move_to_next_payloaded_impl(); return res; } // suffix
+        iterator& operator--()   { this->move_to_prev_payloaded_impl(); return *this; } // prefix
+        iterator  operator--(int){ iterator res(*this); this->move_to_prev_payloaded_impl(); return res; } // suffix
+
+        bool operator==(const iterator &i) const { return this->is_equal(i); }
+        bool operator!=(const iterator &i) const { return !this->is_equal(i); }
+
+    }; // class iterator
+
+    typedef std::reverse_iterator<iterator>           reverse_iterator;
+    typedef std::reverse_iterator<const_iterator>     const_reverse_iterator;
+
+
+protected: // member fields
+
+    key_compare                   comparator;
+    labels_holder                 labels;
+    size_type                     labels_garbage;   // label elements not referenced by any edge, pool is compacted when they exceed a half
+    nodes_holder                  nodes;            // nodes[0] is the root, root never has payload
+    values_holder                 values;
+    value_free_index_holder       value_free_indexes;
+    node_free_index_holder        node_free_indexes;
+
+
+public: // ctors
+
+    radix_trie_map()
+        : comparator()
+        , labels()
+        , labels_garbage(0)
+        , nodes()
+        , values()
+        , value_free_indexes()
+        , node_free_indexes()
+        {}
+
+    explicit
+    radix_trie_map( const Traits& Comp )
+        : comparator(Comp)
+        , labels()
+        , labels_garbage(0)
+        , nodes()
+        , values()
+        , value_free_indexes()
+        , node_free_indexes()
+        {}
+
+    radix_trie_map( const radix_trie_map & ) = default;
+    radix_trie_map( radix_trie_map && ) = default;
+    radix_trie_map& operator=( const radix_trie_map & ) = default;
+    radix_trie_map& operator=( radix_trie_map && ) = default;
+
+    template<class InputIterator>
+    radix_trie_map( InputIterator f, InputIterator l )
+        : radix_trie_map()
+    {
+        insert( f, l );
+    }
+
+    template<class InputIterator>
+    radix_trie_map( InputIterator f, InputIterator l, const Traits& Comp )
+        : radix_trie_map(Comp)
+    {
+        insert( f, l );
+    }
+
+    void swap( radix_trie_map &t )
+    {
+        std::swap(comparator    , t.comparator    );
+        std::swap(labels_garbage, t.labels_garbage);
+        labels            .swap(t.labels            );
+        nodes             .swap(t.nodes             );
+        values            .swap(t.values            );
+        value_free_indexes.swap(t.value_free_indexes);
+        node_free_indexes .swap(t.node_free_indexes );
+    }
+
+
+public: // std::map like API
+
+    key_compare key_comp( ) const { return comparator; }
+
+    const_iterator begin() const          { const_iterator it(this); begin_impl(it); return it; }
+    iterator begin()                      { iterator it(this); begin_impl(it); return it; }
+    const_iterator end() const            { return const_iterator(this); }
+    iterator end()                        { return iterator(this); }
+
+    reverse_iterator rbegin()             { return (reverse_iterator(end())); }
+    const_reverse_iterator rbegin() const { return (const_reverse_iterator(end())); }
+    reverse_iterator rend()               { return (reverse_iterator(begin())); }
+    const_reverse_iterator rend() const   { return (const_reverse_iterator(begin())); }
+
+    void clear()
+    {
+        labels            .clear();
+        nodes             .clear();
+        values            .clear();
+        value_free_indexes.clear();
+        node_free_indexes .clear();
+        labels_garbage = 0;
+    }
+
+    size_type size() const  { return values.size() - value_free_indexes.size(); }
+    bool empty() const      { return size()==0; }
+
+    //! Количество используемых узлов (без учёта удалённых)
+    size_type nodes_size() const { return nodes.size() - node_free_indexes.size(); }
+
+    size_type get_used_mem() const
+    {
+        size_type edgesSize = 0;
+        typename nodes_holder::const_iterator nIt = nodes.begin();
+        for(; nIt!=nodes.end(); ++nIt)
+            edgesSize += nIt->edges.capacity()*sizeof(radix_edge);
+
+        return sizeof(labels_holder)            + labels.capacity()*sizeof(key_element_type)
+             + sizeof(nodes_holder)             + nodes.capacity()*sizeof(radix_node) + edgesSize
+             + sizeof(values_holder)            + values.capacity()*sizeof(mapped_type)
+             + sizeof(value_free_index_holder)  + value_free_indexes.capacity()*sizeof(value_index)
+             + sizeof(node_free_index_holder)   + node_free_indexes.capacity()*sizeof(node_index)
+             ;
+    }
+
+    size_type count( const key_type& k ) const
+    {
+        return find(k).is_end_iter() ? 0 : 1;
+    }
+
+    iterator find( const key_type& k )             { return find( k.begin(), k.end() ); }
+    const_iterator find( const key_type& k ) const { return find( k.begin(), k.end() ); }
+
+    template<typename KeyIter>
+    iterator find( const KeyIter &b, const KeyIter &e )
+    {
+        iterator it(this);
+        find_impl(b, e, it);
+        return it;
+    }
+
+    template<typename KeyIter>
+    const_iterator find( const KeyIter &b, const KeyIter &e ) const
+    {
+        const_iterator it(this);
+        find_impl(b, e, it);
+        return it;
+    }
+
+    std::pair <iterator, bool> insert( const value_type& v )
+    {
+        MARTY_ADT_TRIE_IMPL_ASSERT( v.first.begin()!=v.first.end() && "can't insert empty sequence" );
+        return insert( v.first.begin(), v.first.end(), v.second );
+    }
+
+    iterator insert( iterator where, const value_type& v )
+    {
+        return insert( v ).first; // ignore hint
+    }
+
+    template<class InputIterator>
+    void insert( InputIterator f, InputIterator l )
+    {
+        for(; f!=l; ++f)
+            insert( *f );
+    }
+
+    template<typename KeyIter>
+    std::pair <iterator, bool> insert( const KeyIter &b, const KeyIter &e, const mapped_type &v )
+    {
+        bool newInserted = false;
+        iterator it(this);
+        node_index nodeIdx = insert_key_sequence_impl(b, e, &it, &newInserted);
+        if (nodeIdx!=node_index_npos)
+            set_node_value(nodeIdx, v);
+        return std::make_pair(it, newInserted);
+    }
+
+    mapped_type& operator[]( const key_type &k )
+    {
+        MARTY_ADT_TRIE_IMPL_ASSERT( k.begin()!=k.end() && "can't insert empty sequence" );
+        node_index nodeIdx = insert_key_sequence_impl(k.begin(), k.end(), (iterator*)0);
+        if (nodes[nodeIdx].value_idx==value_index_npos)
+            set_node_value(nodeIdx, mapped_type());
+        return values[nodes[nodeIdx].value_idx];
+    }
+
+    iterator erase( iterator where )
+    {
+        MARTY_ADT_TRIE_IMPL_ASSERT( where.is_payloaded() && "iterator has no payload" );
+
+        iterator next = where;
+        ++next;
+
+        // node merging invalidates positions, so the next iterator is searched again by key
+        key_type nextKey;
+        bool bHasNext = !next.is_end_iter();
+        if (bHasNext)
+            nextKey = next.key();
+
+        erase_impl(where);
+
+        return bHasNext ? find(nextKey) : end();
+    }
+
+    iterator erase( iterator f, iterator l )
+    {
+        if (l.is_end_iter())
+        {
+            while(f!=l)
+                f = erase(f);
+            return f;
+        }
+
+        key_type lastKey = l.key();
+        while(!f.is_end_iter() && f.key()!=lastKey)
+            f = erase(f);
+        return f;
+    }
+
+    size_type erase( const key_type& k )
+    {
+        iterator it = find( k );
+        if (it.is_end_iter()) return 0;
+        erase_impl( it );
+        return 1;
+    }
+
+
+protected: // impl
+
+    bool is_equal_keys( const key_element_type &k1, const key_element_type &k2 ) const
+    {
+        return !comparator(k1,k2) && !comparator(k2,k1);
+    }
+
+    const radix_edge& get_edge( const radix_position &pos ) const
+    {
+        MARTY_ADT_TRIE_IMPL_ASSERT( pos.node_idx<nodes.size() && "node index out of range" );
+        MARTY_ADT_TRIE_IMPL_ASSERT( pos.edge_idx<nodes[pos.node_idx].edges.size() && "edge index out of range" );
+        return nodes[pos.node_idx].edges[pos.edge_idx];
+    }
+
+    // returns edge index or insert pos
+    size_type find_edge( node_index nodeIdx, const key_element_type &k, bool &bFound ) const
+    {
+        const edges_holder &edges = nodes[nodeIdx].edges;
+        const labels_holder &lbls = labels;
+        const key_compare   &cmp  = comparator;
+
+        typename edges_holder::const_iterator it
+            = std::lower_bound( edges.begin(), edges.end(), k
+                              , [&lbls, &cmp](const radix_edge &edge, const key_element_type &key) { return cmp(lbls[edge.label_pos], key); }
+                              );
+
+        bFound = it!=edges.end() && !cmp(k, labels[it->label_pos]);
+        return static_cast<size_type>(it - edges.begin());
+    }
+
+    template<typename IteratorType>
+    void begin_impl( IteratorType &it ) const
+    {
+        if (nodes.empty() || nodes[0].edges.empty())
+            return;
+        it.push_pos(0, 0);
+        if (!it.is_payloaded())
+            it.move_to_next_payloaded_impl();
+    }
+
+    template<typename KeyIter, typename IteratorType>
+    void find_impl( KeyIter b, const KeyIter &e, IteratorType &it ) const
+    {
+        if (b==e || nodes.empty())
+            return;
+
+        node_index nodeIdx = 0;
+        while(b!=e)
+        {
+            bool bFound = false;
+            size_type edgeIdx = find_edge(nodeIdx, *b, bFound);
+            if (!bFound)
+            {
+                it.curPos.clear();
+                it.str_key.clear();
+                return;
+            }
+
+            const radix_edge &edge = nodes[nodeIdx].edges[edgeIdx];
+            for(size_type i=0; i!=edge.label_len; ++i, ++b)
+            {
+                if (b==e || !is_equal_keys(labels[edge.label_pos+i], *b))
+                {
+                    it.curPos.clear();
+                    it.str_key.clear();
+                    return;
+                }
+            }
+
+            it.push_pos(nodeIdx, edgeIdx);
+            nodeIdx = edge.child_idx;
+        }
+
+        if (!it.is_payloaded())
+        {
+            it.curPos.clear();
+            it.str_key.clear();
+        }
+    }
+
+    node_index add_node_impl()
+    {
+        if (node_free_indexes.empty())
+        {
+            nodes.push_back(radix_node());
+            return nodes.size()-1;
+        }
+        node_index res = node_free_indexes.back();
+        node_free_indexes.pop_back();
+        nodes[res] = radix_node();
+        return res;
+    }
+
+    void remove_node_impl( node_index n )
+    {
+        MARTY_ADT_TRIE_IMPL_ASSERT( n<nodes.size() && "node index out of range" );
+        if (n==(nodes.size()-1))
+        {
+            nodes.pop_back();
+        }
+        else
+        {
+            edges_holder tmp;
+            nodes[n].edges.swap(tmp);
+            nodes[n].value_idx = value_index_npos;
+            node_free_indexes.push_back(n);
+        }
+    }
+
+    void set_node_value( node_index n, const mapped_type &v )
+    {
+        if (nodes[n].value_idx!=value_index_npos)
+        {
+            values[nodes[n].value_idx] = v;
+            return;
+        }
+
+        if (value_free_indexes.empty())
+        {
+            nodes[n].value_idx = values.size();
+            values.push_back(v);
+            return;
+        }
+
+        nodes[n].value_idx = value_free_indexes.back();
+        value_free_indexes.pop_back();
+        values[nodes[n].value_idx] = v;
+    }
+
+    void remove_node_value( node_index n )
+    {
+        value_index i = nodes[n].value_idx;
+        if (i==value_index_npos)
+            return;
+
+        nodes[n].value_idx = value_index_npos;
+        if (i==(values.size()-1))
+        {
+            values.pop_back();
+        }
+        else
+        {
+            values[i] = mapped_type(); // set to default value
+            value_free_indexes.push_back(i);
+        }
+    }
+
+    template<typename KeyIter>
+    label_index append_label( KeyIter b, const KeyIter &e, size_type &len )
+    {
+        label_index pos = labels.size();
+        for(; b!=e; ++b)
+            labels.push_back(*b);
+        len = labels.size() - pos;
+        return pos;
+    }
+
+    //! Возвращает индекс узла, соответствующего ключу; при необходимости разбивает рёбра
+    template<typename KeyIter, typename IteratorType>
+    node_index insert_key_sequence_impl( KeyIter b, const KeyIter &e, IteratorType *pIt, bool *pNewInserted = 0 )
+    {
+        if (pNewInserted) *pNewInserted = false;
+
+        if (b==e)
+            return node_index_npos;
+
+        if (nodes.empty())
+            add_node_impl(); // root
+
+        node_index nodeIdx = 0;
+        while(b!=e)
+        {
+            bool bFound = false;
+            size_type edgeIdx = find_edge(nodeIdx, *b, bFound);
+
+            if (!bFound) // new leaf takes the rest of the key
+            {
+                radix_edge newEdge;
+                newEdge.label_pos = append_label(b, e, newEdge.label_len);
+                newEdge.child_idx = add_node_impl();
+                nodes[nodeIdx].edges.insert(nodes[nodeIdx].edges.begin()+edgeIdx, newEdge);
+                if (pIt) pIt->push_pos(nodeIdx, edgeIdx);
+                if (pNewInserted) *pNewInserted = true;
+                return newEdge.child_idx;
+            }
+
+            radix_edge edge = nodes[nodeIdx].edges[edgeIdx];
+            size_type matchLen = 0;
+            for(; matchLen!=edge.label_len && b!=e && is_equal_keys(labels[edge.label_pos+matchLen], *b); ++matchLen, ++b) {}
+
+            if (matchLen!=edge.label_len) // split edge at matchLen
+            {
+                node_index midIdx = add_node_impl();
+                nodes[midIdx].edges.push_back(radix_edge(edge.label_pos+matchLen, edge.label_len-matchLen, edge.child_idx));
+                nodes[nodeIdx].edges[edgeIdx].label_len = matchLen;
+                nodes[nodeIdx].edges[edgeIdx].child_idx = midIdx;
+                if (pNewInserted) *pNewInserted = true;
+            }
+
+            if (pIt) pIt->push_pos(nodeIdx, edgeIdx);
+            nodeIdx = nodes[nodeIdx].edges[edgeIdx].child_idx;
+        }
+
+        if (pNewInserted && nodes[nodeIdx].value_idx==value_index_npos)
+            *pNewInserted = true;
+
+        return nodeIdx;
+    }
+
+    // merges edge at pos with the single edge of its child
+    void merge_edge( const radix_position &pos )
+    {
+        radix_edge &edge = nodes[pos.node_idx].edges[pos.edge_idx];
+        node_index childIdx = edge.child_idx;
+        MARTY_ADT_TRIE_IMPL_ASSERT( nodes[childIdx].edges.size()==1 && nodes[childIdx].value_idx==value_index_npos && "can't merge edge" );
+
+        radix_edge childEdge = nodes[childIdx].edges[0];
+        if (edge.label_pos+edge.label_len==childEdge.label_pos)
+        {
+            // labels are adjacent in the pool (edge was split before)
+            edge.label_len += childEdge.label_len;
+        }
+        else
+        {
+            // reserve first, so push_back can read from the pool itself
+            label_index newPos = labels.size();
+            labels.reserve(labels.size()+edge.label_len+childEdge.label_len);
+            for(size_type i=0; i!=edge.label_len; ++i)
+                labels.push_back(labels[edge.label_pos+i]);
+            for(size_type i=0; i!=childEdge.label_len; ++i)
+                labels.push_back(labels[childEdge.label_pos+i]);
+            labels_garbage += edge.label_len + childEdge.label_len;
+            edge.label_pos  = newPos;
+            edge.label_len += childEdge.label_len;
+        }
+
+        edge.child_idx = childEdge.child_idx;
+        remove_node_impl(childIdx);
+    }
+
+    template<typename IteratorType>
+    void erase_impl( const IteratorType &where )
+    {
+        positions_holder path = where.curPos;
+        MARTY_ADT_TRIE_IMPL_ASSERT( !path.empty() && "can't erase end iterator" );
+
+        node_index nodeIdx = get_edge(path.back()).child_idx;
+        remove_node_value(nodeIdx);
+
+        if (nodes[nodeIdx].edges.size()==1)
+        {
+            merge_edge(path.back());
+        }
+        else if (nodes[nodeIdx].edges.empty())
+        {
+            radix_position pos = path.back();
+            path.pop_back();
+            labels_garbage += get_edge(pos).label_len; // label stays in the pool
+            nodes[pos.node_idx].edges.erase(nodes[pos.node_idx].edges.begin()+pos.edge_idx);
+            remove_node_impl(nodeIdx);
+
+            // parent may become a pass-through node
+            node_index parentIdx = pos.node_idx;
+            if (!path.empty() && nodes[parentIdx].value_idx==value_index_npos && nodes[parentIdx].edges.size()==1)
+                merge_edge(path.back());
+        }
+
+        if (nodes[0].edges.empty())
+            clear();
+        else if (labels_garbage>labels.size()/2)
+            compact_labels();
+    }
+
+    // rewrites labels of all edges in DFS order, so the pool keeps referenced labels only
+    void compact_labels()
+    {
+        labels_holder newLabels;
+        newLabels.reserve(labels.size()-labels_garbage);
+
+        std::vector<node_index> stack(1, node_index(0));
+        while(!stack.empty())
+        {
+            radix_node &node = nodes[stack.back()];
+            stack.pop_back();
+
+            typename edges_holder::iterator eIt = node.edges.begin();
+            for(; eIt!=node.edges.end(); ++eIt)
+            {
+                label_index newPos = newLabels.size();
+                newLabels.insert( newLabels.end()
+                                , labels.begin() + eIt->label_pos
+                                , labels.begin() + eIt->label_pos + eIt->label_len
+                                );
+                eIt->label_pos = newPos;
+                stack.push_back(eIt->child_idx);
+            }
+        }
+
+        labels.swap(newLabels);
+        labels_garbage = 0;
+    }
+
+}; // class radix_trie_map
+
+//----------------------------------------------------------------------------
+
+} // namespace containers
+} // namespace marty
+
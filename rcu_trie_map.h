@@ -0,0 +1,335 @@
+/*! \file
+    \author Alexander Martynov (Marty AKA al-martyn1) <amart@mail.ru>
+    \copyright (c) 2014-2026 Alexander Martynov
+    \brief trie_map с чтением без блокировок: читатели работают со снимком, писатель публикует новые версии (RCU + эпохи)
+
+    Repository: https://github.com/al-martyn1/marty_containers
+
+    Читатель занимает слот, записывает в него текущую эпоху и читает указатель на опубликованную версию;
+    пока слот занят, эта версия не освобождается. Писатель (писатели сериализуются мьютексом) получает новую
+    версию из текущей, публикует её атомарной заменой указателя и откладывает освобождение старой версии
+    до момента, когда все занятые слоты имеют эпоху больше эпохи её замены.
+
+    Версии - persistent_trie_map (см. persistent_trie_map.h): изменение копирует только узлы на пути ключа,
+    O(глубина), остальные узлы новая версия разделяет со старой. Поэтому публикация не копирует всю версию,
+    а отложенная версия удерживает только свои копии путей.
+
+    Чтение wait-free, если одновременно читающих потоков не больше MARTY_CONTAINERS_RCU_READER_SLOTS,
+    иначе читатель ждёт освобождения слота.
+*/
+
+#pragma once
+
+#include "persistent_trie_map.h"
+//
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//----------------------------------------------------------------------------
+// MARTY_CONTAINERS_RCU_READER_SLOTS - число слотов одновременно читающих потоков
+
+#if !defined(MARTY_CONTAINERS_RCU_READER_SLOTS)
+    #define MARTY_CONTAINERS_RCU_READER_SLOTS 128
+#endif
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+// marty::containers::
+namespace marty {
+namespace containers {
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+template < typename KeyType
+         , typename ValueType
+         , typename Traits    = std::less< typename KeyType::value_type >
+         >
+class rcu_trie_map
+{
+
+public: // types
+
+    typedef persistent_trie_map< KeyType, ValueType, Traits >  map_type;
+
+    typedef typename map_type::key_type                        key_type;
+    typedef typename map_type::mapped_type                     mapped_type;
+    typedef typename map_type::size_type                       size_type;
+    typedef typename map_type::const_iterator                  const_iterator;
+
+    typedef std::uint64_t                                      epoch_type;
+
+    static constexpr size_type reader_slots = (size_type)MARTY_CONTAINERS_RCU_READER_SLOTS;
+
+
+protected: // types
+
+    static constexpr epoch_type idle_epoch = 0;
+
+    // own cache line for each slot, readers of different slots do not share lines
+    struct alignas(64) reader_slot
+    {
+        std::atomic<epoch_type>   epoch;
+
+        reader_slot() : epoch(idle_epoch) {}
+    };
+
+    struct retired_version
+    {
+        const map_type  *pMap;
+        epoch_type       epoch; // readers which entered not later than this epoch may use pMap
+    };
+
+
+public: // snapshot
+
+    //! Снимок опубликованной версии; пока снимок существует, версия не освобождается и не изменяется
+    class snapshot
+    {
+        friend class rcu_trie_map;
+
+        reader_slot      *pSlot;
+        const map_type   *pMap;
+
+        snapshot( reader_slot *s, const map_type *m ) : pSlot(s), pMap(m) {}
+
+    public:
+
+        snapshot( const snapshot & ) = delete;
+        snapshot& operator=( const snapshot & ) = delete;
+
+        snapshot( snapshot &&s ) : pSlot(s.pSlot), pMap(s.pMap)
+        {
+            s.pSlot = 0;
+            s.pMap  = 0;
+        }
+
+        snapshot& operator=( snapshot &&s )
+        {
+            if (&s!=this)
+            {
+                release();
+                pSlot = s.pSlot;  s.pSlot = 0;
+                pMap  = s.pMap;   s.pMap  = 0;
+            }
+            return *this;
+        }
+
+        ~snapshot() { release(); }
+
+        void release()
+        {
+            if (pSlot)
+                pSlot->epoch.store(idle_epoch);
+            pSlot = 0;
+            pMap  = 0;
+        }
+
+        const map_type& get() const        { return *pMap; }
+        const map_type& operator*() const  { return *pMap; }
+        const map_type* operator->() const { return pMap; }
+
+        const_iterator begin() const       { return pMap->begin(); }
+        const_iterator end() const         { return pMap->end(); }
+
+    }; // class snapshot
+
+
+protected: // member fields
+
+    std::atomic<const map_type*>     current;
+    std::atomic<epoch_type>          global_epoch;
+    mutable reader_slot              slots[MARTY_CONTAINERS_RCU_READER_SLOTS];
+
+    std::mutex                       writer_mutex;
+    std::vector<retired_version>     retired;      // guarded by writer_mutex
+
+
+public: // ctors
+
+    rcu_trie_map() : current(new map_type()), global_epoch(1), writer_mutex(), retired() {}
+
+    explicit
+    rcu_trie_map( const map_type &m ) : current(new map_type(m)), global_epoch(1), writer_mutex(), retired() {}
+
+    rcu_trie_map( const rcu_trie_map & ) = delete;
+    rcu_trie_map& operator=( const rcu_trie_map & ) = delete;
+
+    //! Снимков и читателей в момент разрушения быть не должно
+    ~rcu_trie_map()
+    {
+        for(typename std::vector<retired_version>::const_iterator it=retired.begin(); it!=retired.end(); ++it)
+            delete it->pMap;
+        delete current.load();
+    }
+
+
+public: // read API, lock-free
+
+    //! Снимок текущей версии для согласованного чтения и итерации
+    snapshot read() const
+    {
+        reader_slot *pSlot = acquire_slot();
+        return snapshot( pSlot, current.load() );
+    }
+
+    //! Копирует значение по ключу в res, возвращает false, если ключа нет
+    bool find( const key_type &k, mapped_type &res ) const
+    {
+        snapshot s = read();
+        const mapped_type *pVal = s->find_value(k);
+        if (!pVal)
+            return false;
+        res = *pVal;
+        return true;
+    }
+
+    size_type count( const key_type &k ) const
+    {
+        snapshot s = read();
+        return s->count(k);
+    }
+
+    size_type size() const
+    {
+        snapshot s = read();
+        return s->size();
+    }
+
+
+public: // write API, writers are serialized
+
+    //! Вызывает f(map_type&) для снимка текущей версии (копия - O(1)) и публикует результат
+    /*! f заменяет версию новыми, например m = m.insert_or_assign(k, v); несколько изменений публикуются разом.
+        Если f бросает исключение, текущая версия не меняется.
+     */
+    template<typename Updater>
+    void update( Updater f )
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+
+        map_type *pNew = new map_type(*current.load());
+        try
+        {
+            f(*pNew);
+        }
+        catch(...)
+        {
+            delete pNew;
+            throw;
+        }
+
+        publish_locked(pNew);
+    }
+
+    void assign( const map_type &m )
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        publish_locked(new map_type(m));
+    }
+
+    void insert_or_assign( const key_type &k, const mapped_type &v )
+    {
+        update( [&]( map_type &m ) { m = m.insert_or_assign(k, v); } );
+    }
+
+    size_type erase( const key_type &k )
+    {
+        size_type res = 0;
+        update( [&]( map_type &m ) { res = m.count(k); m = m.erase(k); } );
+        return res;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        publish_locked(new map_type());
+    }
+
+    //! Освобождает версии, которые больше не читаются; возвращает количество ещё не освобождённых версий
+    size_type reclaim()
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        return reclaim_locked();
+    }
+
+
+protected: // impl helpers
+
+    reader_slot* acquire_slot() const
+    {
+        // threads start from different slots to avoid contention on the first ones
+        const size_type start = std::hash<std::thread::id>()(std::this_thread::get_id()) % reader_slots;
+
+        for(;;)
+        {
+            for(size_type i=0; i!=reader_slots; ++i)
+            {
+                reader_slot &slot = slots[(start+i)%reader_slots];
+                epoch_type expected = idle_epoch;
+                if (slot.epoch.load()==idle_epoch && slot.epoch.compare_exchange_strong(expected, global_epoch.load()))
+                    return &slot;
+            }
+            std::this_thread::yield(); // more concurrent readers than slots
+        }
+    }
+
+    void publish_locked( const map_type *pNew )
+    {
+        const map_type *pOld = current.exchange(pNew);
+
+        // readers, which stored epoch after this increment, already see pNew
+        retired_version rv;
+        rv.pMap  = pOld;
+        rv.epoch = global_epoch.fetch_add(1);
+        retired.push_back(rv);
+
+        reclaim_locked();
+    }
+
+    size_type reclaim_locked()
+    {
+        epoch_type minActive = global_epoch.load();
+        for(size_type i=0; i!=reader_slots; ++i)
+        {
+            epoch_type e = slots[i].epoch.load();
+            if (e!=idle_epoch && e<minActive)
+                minActive = e;
+        }
+
+        typename std::vector<retired_version>::iterator it = retired.begin();
+        while(it!=retired.end())
+        {
+            if (it->epoch<minActive)
+            {
+                delete it->pMap;
+                it = retired.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        return retired.size();
+    }
+
+}; // class rcu_trie_map
+
+//----------------------------------------------------------------------------
+
+} // namespace containers
+} // namespace marty
+
@@ -0,0 +1,169 @@
+/*! \file
+    \brief Запись frozen_trie в файл, чтение через mapped_frozen_trie и проверка повреждённого файла
+
+    Сборка, например:
+        g++ -std=c++17 -O2 -I<каталог, содержащий marty_containers> frozen_trie_file_sample.cpp
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+
+#include "marty_containers/trie.h"
+#include "marty_containers/frozen_trie.h"
+#include "marty_containers/frozen_trie_file.h"
+
+
+
+typedef marty::containers::trie_map<std::string, std::uint32_t>   words_map;
+typedef marty::containers::mapped_frozen_trie<char, std::uint32_t> mapped_words;
+
+
+
+inline
+bool check_fail( const char *msg )
+{
+    std::cout << "FAILED: " << msg << "\n";
+    return false;
+}
+
+// 8-byte aligned copy of the file image
+inline
+std::vector<std::uint64_t> read_image( const std::string &fileName, std::size_t &size )
+{
+    std::vector<std::uint64_t> res;
+    size = 0;
+    FILE *f = std::fopen(fileName.c_str(), "rb");
+    if (!f)
+        return res;
+    std::fseek(f, 0, SEEK_END);
+    size = (std::size_t)std::ftell(f);
+    std::fseek(f, 0, SEEK_SET);
+    res.resize((size+7)/8);
+    if (std::fread(res.data(), 1, size, f)!=size)
+        size = 0;
+    std::fclose(f);
+    return res;
+}
+
+inline
+bool attach_fails( const std::vector<std::uint64_t> &image, std::size_t size )
+{
+    mapped_words m;
+    try
+    {
+        m.attach(image.data(), size);
+    }
+    catch(const marty::containers::trie_file_error &)
+    {
+        return true;
+    }
+    return false;
+}
+
+
+
+int main()
+{
+    std::mt19937 rng(2026);
+
+    std::map<std::string, std::uint32_t> ref;
+    words_map words;
+    for(std::uint32_t i=0; i!=20000; ++i)
+    {
+        std::string w;
+        std::size_t len = 1 + rng()%10;
+        for(std::size_t j=0; j!=len; ++j)
+            w.push_back((char)('a' + rng()%26));
+        words[w] = i;
+        ref[w]   = i;
+    }
+
+    const std::string fileName = "frozen_trie_file_sample.mft";
+    marty::containers::write_frozen_trie(fileName, marty::containers::freeze(words.get_base()));
+
+    bool ok = true;
+
+    {
+        mapped_words m(fileName);
+
+        // round trip - all keys are found with their values
+        for(std::map<std::string, std::uint32_t>::const_iterator it=ref.begin(); it!=ref.end(); ++it)
+        {
+            mapped_words::const_iterator fit = m.find(it->first.begin(), it->first.end());
+            if (fit.is_end_iter() || !fit.is_payloaded() || fit.payload()!=it->second)
+                ok = check_fail("find");
+        }
+
+        // ordered traversal returns the same keys as std::map
+        std::map<std::string, std::uint32_t>::const_iterator refIt = ref.begin();
+        std::string prefix;
+        m.for_each_prefixed( prefix.begin(), prefix.end()
+                           , [&]( const std::vector<char> &k, const std::uint32_t &v )
+                             {
+                                 if (refIt==ref.end() || std::string(k.begin(), k.end())!=refIt->first || v!=refIt->second)
+                                     ok = check_fail("for_each_prefixed");
+                                 else
+                                     ++refIt;
+                             }
+                           );
+        if (refIt!=ref.end())
+            ok = check_fail("for_each_prefixed - keys missing");
+    }
+
+    // damaged images are rejected on open
+    std::size_t size = 0;
+    std::vector<std::uint64_t> image = read_image(fileName, size);
+    if (!size)
+    {
+        check_fail("read file");
+        return 1;
+    }
+
+    {
+        mapped_words m;
+        m.attach(image.data(), size);
+    }
+
+    if (!attach_fails(image, size/2))
+        ok = check_fail("truncated file accepted");
+
+    const marty::containers::frozen_trie_file_header &hdr = *reinterpret_cast<const marty::containers::frozen_trie_file_header*>(image.data());
+
+    {
+        std::vector<std::uint64_t> bad = image;
+        std::uint32_t *pStateValues = reinterpret_cast<std::uint32_t*>(reinterpret_cast<char*>(bad.data()) + hdr.state_values_offset);
+        for(std::size_t s=0; s!=hdr.states_count; ++s)
+            if (pStateValues[s]!=(std::uint32_t)-1) { pStateValues[s] = (std::uint32_t)hdr.values_count; break; }
+        if (!attach_fails(bad, size))
+            ok = check_fail("value index out of range accepted");
+    }
+
+    {
+        std::vector<std::uint64_t> bad = image;
+        std::uint32_t *pChildRanges = reinterpret_cast<std::uint32_t*>(reinterpret_cast<char*>(bad.data()) + hdr.child_ranges_offset);
+        pChildRanges[1] = (std::uint32_t)hdr.children_count + 1;
+        if (!attach_fails(bad, size))
+            ok = check_fail("child range out of range accepted");
+    }
+
+    {
+        std::vector<std::uint64_t> bad = image;
+        std::uint32_t *pChildren = reinterpret_cast<std::uint32_t*>(reinterpret_cast<char*>(bad.data()) + hdr.children_offset);
+        pChildren[0] = 0; // loop to root
+        if (!attach_fails(bad, size))
+            ok = check_fail("child loop accepted");
+    }
+
+    std::remove(fileName.c_str());
+
+    std::cout << (ok ? "OK" : "FAILED") << "\n";
+    return ok ? 0 : 1;
+}
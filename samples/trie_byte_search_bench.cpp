@@ -0,0 +1,153 @@
+/*! \file
+    \brief Замер скорости поиска дочерних узлов trie для однобайтовых ключей: SIMD (byte_lower_bound) против std::lower_bound
+
+    Сборка, например:
+        g++ -std=c++17 -O2 trie_byte_search_bench.cpp                                                        - раскладка по умолчанию
+        g++ -std=c++17 -O2 -DUSE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS trie_byte_search_bench.cpp                   - SSE2
+        g++ -std=c++17 -O2 -mavx2 -DUSE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS trie_byte_search_bench.cpp            - AVX2
+        g++ -std=c++17 -O2 -DUSE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS -DMARTY_CONTAINERS_NO_SIMD trie_byte_search_bench.cpp
+
+    Первая часть (поиск в одном узле) от раскладки не зависит.
+    Вторая часть (поиск в trie целиком) сравнивается между сборками: byte_lower_bound используется только
+    в раскладке USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS (ключи узла лежат подряд), раскладка по умолчанию -
+    базовый вариант с двоичным поиском по элементам узла.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cassert>
+
+#include "marty_containers/trie.h"
+
+
+
+typedef std::chrono::steady_clock bench_clock;
+
+inline
+double seconds_since( bench_clock::time_point start )
+{
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+
+
+template<typename SearchFn>
+double bench_node_search( const std::vector<unsigned char> &keys, const std::vector<unsigned char> &queries, std::size_t rounds, SearchFn fn )
+{
+    std::size_t sum = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for(std::size_t r=0; r!=rounds; ++r)
+    {
+        for(std::vector<unsigned char>::const_iterator qIt=queries.begin(); qIt!=queries.end(); ++qIt)
+            sum += fn(keys, *qIt);
+    }
+    double secs = seconds_since(start);
+    if (sum==(std::size_t)-1) std::cout << ""; // keep the result alive
+    return (double)(rounds*queries.size()) / secs / 1.0e6;
+}
+
+
+
+int main()
+{
+    std::mt19937 rng(12345);
+
+    std::cout << "Node search, Mlookups/s\n";
+    std::cout << std::setw(8) << "fanout" << std::setw(16) << "lower_bound" << std::setw(16) << "byte_search" << "\n";
+
+    const std::size_t fanouts[] = { 2, 4, 8, 16, 32, 64, 128, 256 };
+    for(std::size_t fi=0; fi!=sizeof(fanouts)/sizeof(fanouts[0]); ++fi)
+    {
+        std::vector<unsigned char> all(256);
+        for(std::size_t i=0; i!=256; ++i) all[i] = (unsigned char)i;
+        std::shuffle(all.begin(), all.end(), rng);
+
+        std::vector<unsigned char> keys(all.begin(), all.begin()+fanouts[fi]);
+        std::sort(keys.begin(), keys.end());
+
+        std::vector<unsigned char> queries(4096);
+        for(std::size_t i=0; i!=queries.size(); ++i)
+            queries[i] = keys[rng()%keys.size()]; // hits only, as in a trie walk
+
+        double lb = bench_node_search( keys, queries, 2000
+                                     , [](const std::vector<unsigned char> &k, unsigned char q)
+                                       {
+                                           return (std::size_t)(std::lower_bound(k.begin(), k.end(), q) - k.begin());
+                                       }
+                                     );
+        double bs = bench_node_search( keys, queries, 2000
+                                     , [](const std::vector<unsigned char> &k, unsigned char q)
+                                       {
+                                           return marty::containers::byte_lower_bound(k.data(), k.size(), q);
+                                       }
+                                     );
+
+        std::cout << std::setw(8) << fanouts[fi]
+                  << std::setw(16) << std::fixed << std::setprecision(1) << lb
+                  << std::setw(16) << std::fixed << std::setprecision(1) << bs
+                  << "\n";
+    }
+
+
+    // Whole trie lookup: random words over full byte alphabet near the root, narrowing deeper
+    marty::containers::trie<char, unsigned> t;
+    std::vector<std::string> words;
+    for(unsigned i=0; i!=200000; ++i)
+    {
+        std::string w;
+        std::size_t len = 3 + rng()%10;
+        for(std::size_t j=0; j!=len; ++j)
+            w.push_back( (char)( j<2 ? (rng()%256) : ('a' + rng()%26) ) );
+        t.insert(w.begin(), w.end(), i);
+        words.push_back(w);
+    }
+
+    std::shuffle(words.begin(), words.end(), rng);
+
+    const char *layout =
+              #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS) && defined(MARTY_CONTAINERS_NO_SIMD)
+              "split keys, no SIMD";
+              #elif defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+              "split keys, byte_lower_bound";
+              #else
+              "default, binary search";
+              #endif
+
+    std::cout << "\nTrie lookup (" << layout << "), Mwords/s, best of 5 rounds\n";
+
+    // lookup - plain walk by node indexes, find - the same walk building iterator path
+    double bestLookup = 0, bestFind = 0;
+    std::size_t found = 0;
+    for(unsigned r=0; r!=5; ++r)
+    {
+        bench_clock::time_point start = bench_clock::now();
+        for(std::vector<std::string>::const_iterator wIt=words.begin(); wIt!=words.end(); ++wIt)
+        {
+            if (t.lookup(wIt->begin(), wIt->end()))
+                ++found;
+        }
+        bestLookup = std::max(bestLookup, (double)words.size() / seconds_since(start) / 1.0e6);
+
+        start = bench_clock::now();
+        for(std::vector<std::string>::const_iterator wIt=words.begin(); wIt!=words.end(); ++wIt)
+        {
+            if (t.find(wIt->begin(), wIt->end())!=t.end())
+                ++found;
+        }
+        bestFind = std::max(bestFind, (double)words.size() / seconds_since(start) / 1.0e6);
+    }
+
+    std::cout << std::setw(8) << "lookup" << std::setw(10) << std::fixed << std::setprecision(2) << bestLookup << "\n"
+              << std::setw(8) << "find"   << std::setw(10) << std::fixed << std::setprecision(2) << bestFind   << "\n"
+              << "(" << found << " found)\n";
+
+    return 0;
+}
+
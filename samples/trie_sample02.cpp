@@ -44,51 +44,8 @@
 template <typename IterType> inline
 std::size_t findSymbolLen( const marty::adt::trie< char, unsigned> &trie, IterType curIt, IterType endIt )
 {
-    std::size_t len = 0;
-
-    if (curIt==endIt)
-        return len;
-
-    marty::adt::trie< char, unsigned>::const_iterator tit = trie.find(trie.end(), *curIt);
-    if (tit==trie.end())
-        return len;
-
-    // if (!tit.is_payloaded())
-    //     return len;
-
-    //std::vector<std::size_t> payloadedLens;
-
-    std::size_t payloadedLen = 0;
-    marty::adt::trie< char, unsigned>::const_iterator payloadedTit = trie.end(); // если нужно получить полезную нагрузку
-
-    ++curIt; ++len;
-
-    if (tit.is_payloaded())
-    {
-        //payloadedLens.emplace_back(len);
-        payloadedLen = len;
-        payloadedTit = tit;
-    }
-
-    while(curIt!=endIt)
-    {
-        tit = trie.find(tit, *curIt);
-        if (tit==trie.end())
-        {
-            break;
-        }
-
-        ++curIt; ++len;
-        if (tit.is_payloaded())
-        {
-            //payloadedLens.emplace_back(len);
-            payloadedLen = len;
-            payloadedTit = tit;
-        }
-    }
-
-    return payloadedLen;
-
+    // longest_match проходит по узлам без построения итераторов, в отличие от trie.find(tit, ch)
+    return trie.longest_match( curIt, endIt ).length;
 }
 
 
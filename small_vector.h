@@ -0,0 +1,211 @@
+/*! \file
+    \author Alexander Martynov (Marty AKA al-martyn1) <amart@mail.ru>
+    \copyright (c) 2014-2026 Alexander Martynov
+    \brief Вектор с встроенным буфером на N элементов, куча используется только при переполнении буфера
+
+    Repository: https://github.com/al-martyn1/marty_containers
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+// marty::containers::
+namespace marty {
+namespace containers {
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+//! Вектор тривиально копируемых элементов, первые N элементов хранятся в самом объекте
+template<typename T, std::size_t N>
+class small_vector
+{
+    static_assert(std::is_trivially_copyable<T>::value, "small_vector requires trivially copyable type");
+    static_assert(N>0, "small_vector inline capacity must be non-zero");
+
+public:
+
+    typedef T                  value_type;
+    typedef std::size_t        size_type;
+    typedef std::ptrdiff_t     difference_type;
+    typedef T&                 reference;
+    typedef const T&           const_reference;
+    typedef T*                 pointer;
+    typedef const T*           const_pointer;
+    typedef T*                 iterator;
+    typedef const T*           const_iterator;
+
+    static constexpr size_type inline_capacity = N;
+
+
+protected:
+
+    T          *m_pData;
+    size_type   m_size;
+    size_type   m_capacity;
+    alignas(T) unsigned char m_inlineBuf[N*sizeof(T)]; // raw storage, elements are not default constructed
+
+    T*       inline_data()       { return reinterpret_cast<T*>(&m_inlineBuf[0]); }
+    const T* inline_data() const { return reinterpret_cast<const T*>(&m_inlineBuf[0]); }
+
+    bool is_inline() const { return m_pData==inline_data(); }
+
+    void release()
+    {
+        if (!is_inline())
+            delete[] m_pData;
+        m_pData    = inline_data();
+        m_capacity = N;
+    }
+
+    void grow( size_type newCapacity )
+    {
+        T *pNew = new T[newCapacity];
+        if (m_size)
+            std::memcpy( (void*)pNew, (const void*)m_pData, m_size*sizeof(T) );
+        if (!is_inline())
+            delete[] m_pData;
+        m_pData    = pNew;
+        m_capacity = newCapacity;
+    }
+
+    void assign_from( const small_vector &v )
+    {
+        if (v.m_size>m_capacity)
+            grow(v.m_size);
+        if (v.m_size)
+            std::memcpy( (void*)m_pData, (const void*)v.m_pData, v.m_size*sizeof(T) );
+        m_size = v.m_size;
+    }
+
+    // takes heap buffer of v, or copies its inline elements
+    void move_from( small_vector &v )
+    {
+        if (v.is_inline())
+           {
+            assign_from(v);
+           }
+        else
+           {
+            release();
+            m_pData      = v.m_pData;
+            m_size       = v.m_size;
+            m_capacity   = v.m_capacity;
+            v.m_pData    = v.inline_data();
+            v.m_capacity = N;
+           }
+        v.m_size = 0;
+    }
+
+
+public:
+
+    small_vector() : m_pData(inline_data()), m_size(0), m_capacity(N) {}
+
+    small_vector( const small_vector &v ) : m_pData(inline_data()), m_size(0), m_capacity(N)
+    {
+        assign_from(v);
+    }
+
+    small_vector( small_vector &&v ) : m_pData(inline_data()), m_size(0), m_capacity(N)
+    {
+        move_from(v);
+    }
+
+    ~small_vector()
+    {
+        release();
+    }
+
+    small_vector& operator=( const small_vector &v )
+    {
+        if (&v!=this)
+            assign_from(v);
+        return *this;
+    }
+
+    small_vector& operator=( small_vector &&v )
+    {
+        if (&v!=this)
+            move_from(v);
+        return *this;
+    }
+
+    void swap( small_vector &v )
+    {
+        small_vector tmp(std::move(v));
+        v     = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    size_type size()     const { return m_size; }
+    size_type capacity() const { return m_capacity; }
+    bool      empty()    const { return m_size==0; }
+
+    void reserve( size_type s )
+    {
+        if (s>m_capacity)
+            grow(s);
+    }
+
+    void clear() { m_size = 0; }
+
+    void push_back( const T &t )
+    {
+        if (m_size==m_capacity)
+           {
+            T tmp = t; // t may refer to own element
+            grow(2*m_capacity);
+            m_pData[m_size++] = tmp;
+            return;
+           }
+        m_pData[m_size++] = t;
+    }
+
+    void pop_back()                  { --m_size; }
+
+    reference       back()           { return m_pData[m_size-1]; }
+    const_reference back() const     { return m_pData[m_size-1]; }
+    reference       front()          { return m_pData[0]; }
+    const_reference front() const    { return m_pData[0]; }
+
+    reference       operator[]( size_type i )       { return m_pData[i]; }
+    const_reference operator[]( size_type i ) const { return m_pData[i]; }
+
+    pointer         data()           { return m_pData; }
+    const_pointer   data() const     { return m_pData; }
+
+    iterator        begin()          { return m_pData; }
+    const_iterator  begin() const    { return m_pData; }
+    iterator        end()            { return m_pData+m_size; }
+    const_iterator  end() const      { return m_pData+m_size; }
+
+    bool operator==( const small_vector &v ) const
+    {
+        return m_size==v.m_size && std::equal( begin(), end(), v.begin() );
+    }
+
+    bool operator!=( const small_vector &v ) const
+    {
+        return !operator==(v);
+    }
+
+}; // class small_vector
+
+//----------------------------------------------------------------------------
+
+} // namespace containers
+} // namespace marty
+
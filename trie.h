@@ -48,6 +48,29 @@
     #include <utility>
 #endif
 
+#if !defined(_ITERATOR_) && !defined(_STLP_ITERATOR) && !defined(__STD_ITERATOR__) && !defined(_CPP_ITERATOR) && !defined(_GLIBCXX_ITERATOR)
+    #include <iterator>
+#endif
+
+#if !defined(_FUNCTIONAL_) && !defined(_STLP_FUNCTIONAL) && !defined(__STD_FUNCTIONAL__) && !defined(_CPP_FUNCTIONAL) && !defined(_GLIBCXX_FUNCTIONAL)
+    #include <functional>
+#endif
+
+
+#include <memory>
+#include <type_traits>
+
+#if defined(__has_include)
+    #if __has_include(<memory_resource>) && (__cplusplus>=201703L || (defined(_MSVC_LANG) && _MSVC_LANG>=201703L))
+        #include <memory_resource>
+        #define MARTY_ADT_TRIE_HAS_PMR
+    #endif
+#endif
+
+#include "byte_search.h"
+#include "small_vector.h"
+#include "exceptions.h"
+
 
 #ifndef MARTY_ADT_TRIE_IMPL_ASSERT
     #ifdef BOOST_ASSERT
@@ -61,7 +84,33 @@
 
 
 
-#define MARTY_ADT_TRIE_ITERATOR_RESERVE_MAGIC_NUMBER 256
+// number of path levels stored inside trie iterator, deeper paths are spilled to heap
+#ifndef MARTY_ADT_TRIE_ITERATOR_INLINE_PATH_SIZE
+    #define MARTY_ADT_TRIE_ITERATOR_INLINE_PATH_SIZE 16
+#endif
+
+// USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS - keys of node are duplicated into separate dense array,
+// binary search touches only keys, child/value indexes are loaded only on hit;
+// for 1-byte keys with std::less keys are searched by SIMD compare (see byte_search.h).
+// SIMD compare wins on nodes with 16+ items only; on tries with mostly narrow nodes the default layout
+// is as fast or faster - measure with samples/trie_byte_search_bench.cpp
+#if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS) && defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+    #error "USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS can't be used with USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY"
+#endif
+
+// USE_MARTY_ADT_TRIE_ADAPTIVE_NODES - for 1-byte keys with std::less node switches its kind by fan-out:
+// narrow nodes (up to 16 items) are searched in sorted items, wide nodes get direct byte->item index (O(1) transition)
+#if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES) && defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+    #error "USE_MARTY_ADT_TRIE_ADAPTIVE_NODES can't be used with USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY"
+#endif
+
+#ifndef MARTY_ADT_TRIE_ADAPTIVE_NODE_GROW_SIZE
+    #define MARTY_ADT_TRIE_ADAPTIVE_NODE_GROW_SIZE    16
+#endif
+
+#ifndef MARTY_ADT_TRIE_ADAPTIVE_NODE_SHRINK_SIZE
+    #define MARTY_ADT_TRIE_ADAPTIVE_NODE_SHRINK_SIZE  12
+#endif
 
 
 
@@ -142,6 +191,8 @@ class trie_iterator_base_impl;
 template < typename KeyType
          , typename ValueType
          , typename Traits
+         , typename IndexType
+         , typename Allocator
          >
 class trie_map;
 
@@ -149,11 +200,39 @@ class trie_map;
 template<typename T>
 class trie_inspector;
 
+template < typename KeyType
+         , typename ValueType
+         , typename Traits
+         >
+class frozen_trie;
+
+template < typename KeyType
+         , typename ValueType
+         , typename Traits
+         , typename IndexType
+         , typename Allocator
+         >
+class aho_corasick;
+
+template < typename KeyType
+         , typename ValueType
+         , typename Monoid
+         , typename Traits
+         , typename IndexType
+         >
+class augmented_trie_map;
+
 
 
+//! IndexType - беззнаковый тип индексов узлов, элементов узлов и значений; std::uint32_t/std::uint16_t уменьшают расход памяти на небольших trie
+/*! Allocator - аллокатор для всех внутренних массивов trie, включая элементы узлов;
+    перепривязывается (rebind) к типу элементов каждого массива.
+ */
 template < typename KeyType
          , typename ValueType
-         , typename Traits = std::less< KeyType >
+         , typename Traits    = std::less< KeyType >
+         , typename IndexType = std::size_t
+         , typename Allocator = std::allocator< ValueType >
          >
 class trie
 {
@@ -165,14 +244,18 @@ public:
     typedef KeyType       key_type;
     typedef ValueType     mapped_type;
     typedef Traits        key_compare;
+    typedef IndexType     index_type;
+    typedef Allocator     allocator_type;
 
     typedef std::size_t   size_type;
 
+    static_assert(std::is_integral<IndexType>::value && std::is_unsigned<IndexType>::value, "IndexType must be unsigned integral type");
+
     typedef KeyType                                             value_type;
     typedef std::ptrdiff_t                                      difference_type;
 
-    friend class trie_const_iterator_impl< trie<key_type,mapped_type,key_compare> >;
-    friend class trie_iterator_impl< trie<key_type,mapped_type,key_compare> >;
+    friend class trie_const_iterator_impl< trie<key_type,mapped_type,key_compare,index_type,allocator_type> >;
+    friend class trie_iterator_impl< trie<key_type,mapped_type,key_compare,index_type,allocator_type> >;
 
     //template<class T> friend class trie_map_iterator_impl< trie, T >;
     template < typename TrieType, typename T> // !!!
@@ -184,40 +267,82 @@ public:
     template < typename MapKeyType
              , typename MapValueType
              , typename MapTraits
+             , typename MapIndexType
+             , typename MapAllocator
              >
     friend class trie_map; // !!!
 
     template<typename U>
     friend class trie_inspector;
 
-    typedef trie_const_iterator_impl< trie<key_type,mapped_type,key_compare> >   const_iterator;
-    typedef trie_iterator_impl< trie<key_type,mapped_type,key_compare> >         iterator;
+    template < typename FrozenKeyType
+             , typename FrozenValueType
+             , typename FrozenTraits
+             >
+    friend class frozen_trie;
+
+    template < typename AcKeyType
+             , typename AcValueType
+             , typename AcTraits
+             , typename AcIndexType
+             , typename AcAllocator
+             >
+    friend class aho_corasick;
+
+    template < typename AugKeyType
+             , typename AugValueType
+             , typename AugMonoid
+             , typename AugTraits
+             , typename AugIndexType
+             >
+    friend class augmented_trie_map;
+
+    typedef trie_const_iterator_impl< trie<key_type,mapped_type,key_compare,index_type,allocator_type> >   const_iterator;
+    typedef trie_iterator_impl< trie<key_type,mapped_type,key_compare,index_type,allocator_type> >         iterator;
 
     typedef std::reverse_iterator<iterator>                     reverse_iterator;
     typedef std::reverse_iterator<const_iterator>               const_reverse_iterator;
 
+    //! Результат поиска наибольшего префикса: длина совпадения и указатель на значение (0, если совпадения нет)
+    template<typename MappedPtr>
+    struct basic_match_result
+    {
+        size_type     length;
+        MappedPtr     value;
+
+        basic_match_result( size_type l = 0, MappedPtr v = 0 ) : length(l), value(v) {}
+
+        bool matched() const { return value!=0; }
+    };
+
+    typedef basic_match_result<mapped_type*>                    match_result;
+    typedef basic_match_result<const mapped_type*>              const_match_result;
+
     struct  trie_node_data_item;
     struct  trie_node;
 
     friend struct trie_node;
 
-    typedef std::vector< trie_node_data_item >             trie_node_data_item_holder;
-    typedef typename trie_node_data_item_holder::size_type trie_node_data_item_index;
+    template<typename T>
+    using rebind_alloc = typename std::allocator_traits<allocator_type>::template rebind_alloc<T>;
+
+    typedef std::vector< trie_node_data_item, rebind_alloc<trie_node_data_item> >  trie_node_data_item_holder;
+    typedef IndexType                                      trie_node_data_item_index;
     const static trie_node_data_item_index                 trie_node_data_item_index_npos = static_cast<trie_node_data_item_index>(-1);
     
-    typedef std::vector< trie_node >                     trie_nodes_holder;
-    typedef typename trie_nodes_holder::size_type        trie_node_index;
+    typedef std::vector< trie_node, rebind_alloc<trie_node> >      trie_nodes_holder;
+    typedef IndexType                                    trie_node_index;
     const static trie_node_index                         trie_node_index_npos  = static_cast<trie_node_index>(-1);
 
-    typedef std::vector< mapped_type >                   values_holder;
+    typedef std::vector< mapped_type, rebind_alloc<mapped_type> >  values_holder;
     
-    typedef typename values_holder::size_type            value_index;
+    typedef IndexType                                    value_index;
     const static value_index                             value_index_npos      = static_cast<value_index>(-1);
 
     //typedef std::stack< value_index    , std::vector<value_index> >     value_free_index_holder;
     //typedef std::stack< trie_node_index, std::vector<trie_node_index> > trie_node_free_index_holder;
-    typedef std::vector< value_index     >     value_free_index_holder;
-    typedef std::vector< trie_node_index > trie_node_free_index_holder;
+    typedef std::vector< value_index, rebind_alloc<value_index> >          value_free_index_holder;
+    typedef std::vector< trie_node_index, rebind_alloc<trie_node_index> >  trie_node_free_index_holder;
 
 
 
@@ -226,10 +351,11 @@ public:
         key_type               key;
         trie_node_index        child_idx;
         value_index            value_idx;
+        value_index            payload_count; // payloaded keys in subtree, including this one
         trie_node_data_item(const key_type &k = key_type()
                       , trie_node_index chidx = trie_node_index_npos
                       , value_index vidx = value_index_npos)
-            : key(k), child_idx(chidx), value_idx(vidx)
+            : key(k), child_idx(chidx), value_idx(vidx), payload_count(0)
             {}
     };
 
@@ -258,36 +384,233 @@ public:
              { return node_idx!=tp.node_idx || item_idx!=tp.item_idx; }
     }; // struct trie_position
 
+    typedef small_vector< trie_position, MARTY_ADT_TRIE_ITERATOR_INLINE_PATH_SIZE >  trie_path;
+
     struct trie_node
     {
-        typedef class trie<KeyType,ValueType,Traits> trie_type;
+        typedef class trie<KeyType,ValueType,Traits,IndexType,Allocator> trie_type;
 
         #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+        // node items are stored in slab [first_item, first_item+capacity) of trie_node_data_items,
+        // slab is relocated to twice larger one on overflow, so insert/erase touches only this node
         trie_node_data_item_index    first_item;
         trie_node_data_item_index    size;
+        trie_node_data_item_index    capacity;
         //trie_node_index              parent_idx;
         trie_node( trie_node_data_item_index fi = trie_node_index_npos, trie_node_data_item_index s = 0) 
-           : first_item(fi), size(s) /* , parent_idx(pi) */  {}
-        trie_node( trie_node_data_item_index fi, trie_node_data_item_index s, trie_node_index pi) 
-           : first_item(fi), size(s) /* , parent_idx(pi) */  {}
+           : first_item(fi), size(s), capacity(s) /* , parent_idx(pi) */  {}
+        trie_node( trie_node_data_item_index fi, trie_node_data_item_index s, trie_node_data_item_index cap) 
+           : first_item(fi), size(s), capacity(cap) /* , parent_idx(pi) */  {}
         #else
+        // uses-allocator construction: scoped allocators (std::pmr) pass own resource to node arrays
+        typedef rebind_alloc<trie_node_data_item>                          allocator_type;
+        typedef std::vector< key_type, rebind_alloc<key_type> >            keys_holder;
+        typedef std::vector< unsigned char, rebind_alloc<unsigned char> >  byte_index_holder;
+
         trie_node_data_item_holder    data_items;
+            #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+        keys_holder                   keys; // dense copy of data_items[i].key, used for search only
+            #endif
+            #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+        byte_index_holder             byte_index; // wide nodes only: byte value -> item index, entries are verified by key
+            #endif
         trie_node() : data_items() { }
+
+        explicit trie_node( const allocator_type &a )
+           : data_items(a)
+            #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+           , keys(a)
+            #endif
+            #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+           , byte_index(a)
+            #endif
+           { }
+
+        trie_node( const trie_node &n ) = default;
+        trie_node( trie_node &&n ) = default;
+        trie_node& operator=( const trie_node &n ) = default;
+        trie_node& operator=( trie_node &&n ) = default;
+
+        trie_node( const trie_node &n, const allocator_type &a )
+           : data_items(n.data_items, a)
+            #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+           , keys(n.keys, a)
+            #endif
+            #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+           , byte_index(n.byte_index, a)
+            #endif
+           { }
+
+        trie_node( trie_node &&n, const allocator_type &a )
+           : data_items(std::move(n.data_items), a)
+            #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+           , keys(std::move(n.keys), a)
+            #endif
+            #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+           , byte_index(std::move(n.byte_index), a)
+            #endif
+           { }
+        #endif
+
+        #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+
+        typedef std::integral_constant<bool, byte_key_search_traits<key_type,key_compare>::enabled> adaptive_node_tag;
+
+        //! true - прямой индекс по значению байта, false - поиск по отсортированным элементам
+        bool is_byte_indexed() const
+           {
+            return !byte_index.empty();
+           }
+
+        // promotes/demotes node and rebuilds byte index, called after item inserted/erased at any position
+        void update_byte_index( std::true_type )
+           {
+            trie_node_data_item_index sz = data_items.size();
+            if (byte_index.empty())
+               {
+                if (sz<=MARTY_ADT_TRIE_ADAPTIVE_NODE_GROW_SIZE) return;
+                byte_index.resize(256);
+               }
+            else if (sz<MARTY_ADT_TRIE_ADAPTIVE_NODE_SHRINK_SIZE)
+               {
+                byte_index_holder tmp(byte_index.get_allocator());
+                byte_index.swap(tmp);
+                return;
+               }
+
+            for(trie_node_data_item_index i=0; i!=sz; ++i)
+                byte_index[(unsigned char)data_items[i].key] = (unsigned char)i;
+           }
+
+        void update_byte_index( std::false_type ) {}
+
+        // item appended to the end - no index shift required
+        void update_byte_index_appended( std::true_type )
+           {
+            if (byte_index.empty())
+               {
+                update_byte_index( std::true_type() );
+                return;
+               }
+            byte_index[(unsigned char)data_items.back().key] = (unsigned char)(data_items.size()-1);
+           }
+
+        void update_byte_index_appended( std::false_type ) {}
+
+        // returns true if key found by byte index
+        bool find_key_by_byte_index( const key_type &k, trie_node_data_item_index &idx, std::true_type ) const
+           {
+            if (byte_index.empty()) return false;
+            idx = byte_index[(unsigned char)k];
+            return idx<data_items.size() && data_items[idx].key==k;
+           }
+
+        bool find_key_by_byte_index( const key_type &k, trie_node_data_item_index &idx, std::false_type ) const
+           {
+            return false;
+           }
+
         #endif
 
         void reserve( size_t s )
             {
-             #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+             #if !defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
              data_items.reserve(s);
+                 #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+             keys.reserve(s);
+                 #endif
              #endif
             }
 
-        void clear()
+        #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+        // copies node items to the end of newItems as exact sized slab
+        void relocate_items( const trie_type *pt, trie_node_data_item_holder &newItems )
+           {
+            trie_node_data_item_index newFirst = (trie_node_data_item_index)newItems.size();
+            if (size)
+                newItems.insert( newItems.end()
+                               , pt->trie_node_data_items.begin() + first_item
+                               , pt->trie_node_data_items.begin() + first_item + size
+                               );
+            first_item = size ? newFirst : trie_node_index_npos;
+            capacity   = size;
+           }
+        #else
+        void shrink_to_fit()
+           {
+            data_items.shrink_to_fit();
+            #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+            keys.shrink_to_fit();
+            #endif
+           }
+        #endif
+
+        #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+        void clear( trie_type *pt )
+        #else
+        void clear( trie_type * /* pt */ )
+        #endif
            {
-            trie_node_data_item_holder tmp;
+            #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+            if (capacity)
+                pt->free_data_slab( first_item, capacity );
+            first_item = trie_node_index_npos;
+            size       = 0;
+            capacity   = 0;
+            #else
+            trie_node_data_item_holder tmp(data_items.get_allocator());
             data_items.swap(tmp);
+            #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+            keys_holder tmpKeys(keys.get_allocator());
+            keys.swap(tmpKeys);
+            #endif
+            #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+            byte_index_holder tmpIndex(byte_index.get_allocator());
+            byte_index.swap(tmpIndex);
+            #endif
+            #endif
+           }
+
+        #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+        // makes room for one more item, relocates node items to larger slab if needed
+        void grow_slab( trie_type *pt )
+           {
+            if (size<capacity) return;
+
+            trie_node_data_item_index newCapacity = capacity ? 2*capacity : 1;
+            if (newCapacity<pt->reserve_trie_node_data_items) newCapacity = pt->reserve_trie_node_data_items;
+
+            trie_node_data_item_index newFirst = pt->alloc_data_slab( newCapacity ); // may reallocate trie_node_data_items
+            if (size)
+                std::copy( pt->trie_node_data_items.begin() + first_item
+                         , pt->trie_node_data_items.begin() + first_item + size
+                         , pt->trie_node_data_items.begin() + newFirst
+                         );
+            if (capacity)
+                pt->free_data_slab( first_item, capacity );
+
+            first_item = newFirst;
+            capacity   = pt->data_slab_capacity( newCapacity );
            }
 
+        void insert_data_item_at( trie_type *pt, trie_node_data_item_index localIdx, const trie_node_data_item &i )
+           {
+            MARTY_ADT_TRIE_IMPL_ASSERT( localIdx<=size && "node item index out of range" );
+            trie_node_data_item item = i; // i may refer into trie_node_data_items
+            grow_slab( pt );
+            typename trie_node_data_item_holder::iterator b = pt->trie_node_data_items.begin() + first_item;
+            std::copy_backward( b + localIdx, b + size, b + size + 1 );
+            b[localIdx] = item;
+            ++size;
+           }
+
+        trie_node_data_item_index iteratorToInsertIndex( trie_type *pt, typename trie_node_data_item_holder::iterator pos ) const
+           {
+            if (!capacity) return 0;
+            return (trie_node_data_item_index)(pos - pt->trie_node_data_items.begin() - first_item);
+           }
+        #endif
+
         trie_node_data_item_index keys_size() const
            {
             #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
@@ -302,7 +625,7 @@ public:
             #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
             MARTY_ADT_TRIE_IMPL_ASSERT( idx<size && "node data index (idx) out of range" );
             idx += first_item;
-            MARTY_ADT_TRIE_IMPL_ASSERT( idx<trie_node_data_items.size() && "node data index (first_item) out of range" );
+            MARTY_ADT_TRIE_IMPL_ASSERT( idx<pt->trie_node_data_items.size() && "node data index (first_item) out of range" );
             return pt->trie_node_data_items[idx];
             #else
             MARTY_ADT_TRIE_IMPL_ASSERT( idx<data_items.size() && "node data index (idx) out of range" );
@@ -318,8 +641,14 @@ public:
         typename trie_node_data_item_holder::iterator find_key_impl( trie_type *pt, const key_type &k, bool &bFound /* else return insert pos */ )
            {
             #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+            if (!capacity)
+               {
+                bFound = false;
+                return pt->trie_node_data_items.begin();
+               }
+
             MARTY_ADT_TRIE_IMPL_ASSERT( (first_item)<pt->trie_node_data_items.size() && "node data index (first_item) out of range" );
-            MARTY_ADT_TRIE_IMPL_ASSERT( (first_item+size)<pt->trie_node_data_items.size() && "node data index (size) out of range" );
+            MARTY_ADT_TRIE_IMPL_ASSERT( (first_item+size)<=pt->trie_node_data_items.size() && "node data index (size) out of range" );
 
             typename trie_node_data_item_holder::iterator rangeBegin
                      = pt->trie_node_data_items.begin() + first_item;
@@ -339,9 +668,39 @@ public:
                     bFound = true;
                }
             return foundIt;
+            #elif defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+            bFound = false;
+
+                #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+            trie_node_data_item_index indexedIdx = 0;
+            if (find_key_by_byte_index( k, indexedIdx, adaptive_node_tag() ))
+               {
+                bFound = true;
+                return data_items.begin() + indexedIdx;
+               }
+                #endif
+
+            typename keys_holder::const_iterator keyIt = keys.begin()
+                + keys_lower_bound( pt, k, std::integral_constant<bool, byte_key_search_traits<key_type,key_compare>::enabled>() );
+            if (keyIt!=keys.end())
+               {
+                MARTY_ADT_TRIE_IMPL_ASSERT(!(pt->comparator(k,*keyIt) && pt->comparator(*keyIt,k)) && "invalid order relation");
+                if (pt->comparator(k,*keyIt) == pt->comparator(*keyIt,k))
+                    bFound = true;
+               }
+            return data_items.begin() + (keyIt - keys.begin());
             #else
             bFound = false;
 
+                #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+            trie_node_data_item_index indexedIdx = 0;
+            if (find_key_by_byte_index( k, indexedIdx, adaptive_node_tag() ))
+               {
+                bFound = true;
+                return data_items.begin() + indexedIdx;
+               }
+                #endif
+
             typename trie_node_data_item_holder::iterator foundIt = 
                    ::std::lower_bound( data_items.begin(), data_items.end()
                                      , k, trie_node_data_item_comparator( pt->comparator )
@@ -356,6 +715,19 @@ public:
             #endif
            }
 
+        #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+        // 1-byte keys with std::less - vector compare (SSE2/AVX2) over dense keys
+        std::size_t keys_lower_bound( const trie_type * /* pt */, const key_type &k, std::true_type ) const
+           {
+            return byte_lower_bound( keys.data(), keys.size(), k );
+           }
+
+        std::size_t keys_lower_bound( const trie_type *pt, const key_type &k, std::false_type ) const
+           {
+            return (std::size_t)(::std::lower_bound( keys.begin(), keys.end(), k, pt->comparator ) - keys.begin());
+           }
+        #endif
+
         typename trie_node_data_item_holder::iterator find_key( trie_type *pt, const key_type &k, bool &bFound /* else return insert pos */ )
            {
             return find_key_impl(pt, k, bFound);
@@ -367,10 +739,24 @@ public:
             return const_cast<trie_node*>(this)->find_key_impl( const_cast<trie_type*>(pt), k, bFound );
            }
 
+        // lookup only, result is valid if bFound; byte indexed node answers by index, miss doesn't search insert pos
+        typename trie_node_data_item_holder::const_iterator lookup_key( const trie_type *pt, const key_type &k, bool &bFound ) const
+           {
+            #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+            if (is_byte_indexed())
+               {
+                trie_node_data_item_index indexedIdx = 0;
+                bFound = find_key_by_byte_index( k, indexedIdx, adaptive_node_tag() );
+                return bFound ? data_items.begin() + indexedIdx : data_items.end();
+               }
+            #endif
+            return find_key( pt, k, bFound );
+           }
+
         trie_node_data_item_index find_key_idx( const trie_type *pt, const key_type &k ) const
            {
             bool bFound = false;
-            typename trie_node_data_item_holder::const_iterator fit = find_key( pt, k, bFound );
+            typename trie_node_data_item_holder::const_iterator fit = lookup_key( pt, k, bFound );
             if (bFound)
                {
                 #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
@@ -445,11 +831,17 @@ public:
         void insert_data_item( trie_type *pt, typename trie_node_data_item_holder::iterator pos, const trie_node_data_item &i)
            {
             #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
-            pt->trie_node_data_items.insert( pos, i );
-            ++size;
+            insert_data_item_at( pt, iteratorToInsertIndex( pt, pos ), i );
             #else
             //if (data_items.capacity()<4) data_items.reserve(4);
+            trie_type::check_index_overflow( data_items.size()+1, "node data item" );
+            #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+            keys.insert( keys.begin() + (pos - data_items.begin()), i.key );
+            #endif
             data_items.insert( pos, i );
+                #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+            update_byte_index( adaptive_node_tag() );
+                #endif
             #endif
            }
 
@@ -459,22 +851,51 @@ public:
                            )
            {
             #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
-            pt->trie_node_data_items.insert( pos, trie_node_data_item( k, chidx, vidx ) );
-            ++size;
+            insert_data_item_at( pt, iteratorToInsertIndex( pt, pos ), trie_node_data_item( k, chidx, vidx ) );
             #else
             //if (data_items.capacity()<4) data_items.reserve(4);
+            trie_type::check_index_overflow( data_items.size()+1, "node data item" );
+            #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+            keys.insert( keys.begin() + (pos - data_items.begin()), k );
+            #endif
             data_items.insert( pos, trie_node_data_item( k, chidx, vidx ) );
+                #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+            update_byte_index( adaptive_node_tag() );
+                #endif
+            #endif
+           }
+
+        // appends item to the end of node, caller is responsible for keys order and for node storage preallocation
+        #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+        trie_node_data_item_index append_data_item( trie_type *pt, const key_type &k )
+        #else
+        trie_node_data_item_index append_data_item( trie_type * /* pt */, const key_type &k )
+        #endif
+           {
+            #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+            grow_slab( pt );
+            MARTY_ADT_TRIE_IMPL_ASSERT( (first_item+size)<pt->trie_node_data_items.size() && "node data index (size) out of range" );
+            pt->trie_node_data_items[first_item+size] = trie_node_data_item( k );
+            return size++;
+            #else
+            trie_type::check_index_overflow( data_items.size()+1, "node data item" );
+            data_items.push_back( trie_node_data_item( k ) );
+            #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+            keys.push_back( k );
+            #endif
+            #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+            update_byte_index_appended( adaptive_node_tag() );
+            #endif
+            return data_items.size()-1;
             #endif
            }
 
         void insert_data_item( trie_type *pt, const key_type &k )
            {
             #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
-            if (first_item==trie_node_index_npos)
+            if (!size)
                {
-                first_item = pt->trie_node_data_items.size();
-                pt->trie_node_data_items.push_back( trie_node_data_item( k ) );
-                size = 1;
+                insert_data_item_at( pt, 0, trie_node_data_item( k ) );
                }
             else
                {
@@ -483,9 +904,14 @@ public:
                 if (!bFound) insert_data_item( pt, it, trie_node_data_item(k));
                }
             #else
-            if (data_items.capacity()<pt->reserve_trie_node_data_items) data_items.reserve(pt->reserve_trie_node_data_items);
+            if (data_items.capacity()<pt->reserve_trie_node_data_items) reserve(pt->reserve_trie_node_data_items);
             if (data_items.empty())
+               {
                 data_items.push_back( trie_node_data_item( k ) );
+                #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+                keys.push_back( k );
+                #endif
+               }
             else
                {
                 bool bFound = false;
@@ -499,12 +925,9 @@ public:
 
         void remove_item_value( trie_type *pt, typename trie_node_data_item_holder::iterator pos )
            {
-            #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
-            #else
             if (pos->value_idx!=value_index_npos)
                pt->remove_value_impl( pos->value_idx );
             pos->value_idx = value_index_npos;
-            #endif
            }
            
         void remove_item_value( trie_type *pt, trie_node_data_item_index itemIdx )
@@ -549,26 +972,40 @@ public:
         void erase_key( trie_type *pt, typename trie_node_data_item_holder::iterator pos )
            {
             #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+            if (!size) return;
+            typename trie_node_data_item_holder::iterator b = pt->trie_node_data_items.begin() + first_item;
+            if (pos==b+size) return;
+            MARTY_ADT_TRIE_IMPL_ASSERT( pos>=b && pos<b+size && "iterator is out of node items" );
+            remove_item_value( pt, pos );
+            std::copy( pos+1, b+size, pos );
+            if (!--size)
+                clear( pt ); // return slab to free list
             #else
             if (pos==data_items.end()) return;
             remove_item_value( pt, pos );
+            #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+            keys.erase( keys.begin() + (pos - data_items.begin()) );
+            #endif
             data_items.erase(pos);
+            #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+            update_byte_index( adaptive_node_tag() );
+            #endif
             #endif
            }
 
         void erase_key( trie_type *pt, const key_type &k )
            {
-            #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
-            #else
             bool bFound = false;
             typename trie_node_data_item_holder::iterator fit = find_key( pt, k, bFound );
-            erase_key(pt,fit);
-            #endif
+            if (bFound)
+                erase_key(pt,fit);
            }
         
         void erase_key_by_index( trie_type *pt, trie_node_data_item_index itemIdx )
            {
             #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+            MARTY_ADT_TRIE_IMPL_ASSERT( itemIdx<size && "node item index out of range" );
+            erase_key(pt,pt->trie_node_data_items.begin()+first_item+itemIdx);
             #else
             MARTY_ADT_TRIE_IMPL_ASSERT( itemIdx<data_items.size() && "node item index out of range" );
             erase_key(pt,data_items.begin()+itemIdx);
@@ -588,16 +1025,13 @@ public:
             itemIdx += first_item;
             return pt->trie_node_data_items[itemIdx].value_idx!=value_index_npos;
             #else
-            is_payloaded( pt, data_items.begin() + itemIdx );
+            return is_key_payloaded( pt, data_items.begin() + itemIdx );
             #endif
            }
 
         bool key_has_child( const trie_type *pt, typename trie_node_data_item_holder::const_iterator pos ) const
            {
-            #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
-            #else
             return pos->child_idx!=trie_node_index_npos;
-            #endif
            }
 
         trie_node_index get_child_id( const trie_type *pt, trie_node_data_item_index itemIdx ) const
@@ -622,9 +1056,9 @@ public:
             trie_node_data_item_index idx = 0, s = keys_size();
             for(; idx!=s; ++idx)
                {
-                if (!key_has_child(pt, idx)) continue;
                 if (is_key_payloaded(pt, idx)) return true;
-                pt->trie_nodes[get_child_id(idx)].is_keys_payloaded(pt) return true;
+                if (!key_has_child(pt, idx)) continue;
+                if (pt->trie_nodes[get_child_id(pt, idx)].is_keys_payloaded(pt)) return true;
                }
             return false;
            }
@@ -643,17 +1077,86 @@ protected:
     trie_node_free_index_holder   trie_node_free_indexes;
     #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
     trie_node_data_item_holder    trie_node_data_items;
+    typedef std::vector< trie_node_data_item_index, rebind_alloc<trie_node_data_item_index> >  data_slab_list;
+    typedef std::vector< data_slab_list, rebind_alloc<data_slab_list> >                        data_slab_lists;
+    data_slab_lists               trie_node_data_free_slabs; // [log2(capacity)] -> slab positions
     #endif
     trie_nodes_holder             trie_nodes;
     size_type                     reserve_trie_node_data_items;
 
 
+    #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+
+    static std::size_t data_slab_bucket( trie_node_data_item_index cap )
+    {
+        std::size_t b = 0;
+        for(; (trie_node_data_item_index)2<<b <= cap; ++b) {}
+        return b; // floor(log2(cap))
+    }
+
+    // real capacity of slab allocated for requested capacity
+    static trie_node_data_item_index data_slab_capacity( trie_node_data_item_index cap )
+    {
+        trie_node_data_item_index res = 1;
+        while(res<cap) res *= 2;
+        return res;
+    }
+
+    size_type trie_node_data_free_slabs_used_mem() const
+    {
+        size_type res = trie_node_data_free_slabs.capacity()*sizeof(data_slab_list);
+        for(std::size_t b=0; b!=trie_node_data_free_slabs.size(); ++b)
+            res += trie_node_data_free_slabs[b].capacity()*sizeof(trie_node_data_item_index);
+        return res;
+    }
+
+    trie_node_data_item_index alloc_data_slab( trie_node_data_item_index cap )
+    {
+        cap = data_slab_capacity(cap);
+        std::size_t b = data_slab_bucket(cap);
+        if (b<trie_node_data_free_slabs.size() && !trie_node_data_free_slabs[b].empty())
+           {
+            trie_node_data_item_index res = trie_node_data_free_slabs[b].back();
+            trie_node_data_free_slabs[b].pop_back();
+            return res;
+           }
+        check_index_overflow( trie_node_data_items.size() + cap, "node data item" );
+        trie_node_data_item_index res = trie_node_data_items.size();
+        trie_node_data_items.resize( res + cap );
+        return res;
+    }
+
+    // slab of any capacity (exact sized slabs are built by assign_sorted) is reused as power of two sized one
+    void free_data_slab( trie_node_data_item_index pos, trie_node_data_item_index cap )
+    {
+        MARTY_ADT_TRIE_IMPL_ASSERT( cap && (pos+cap)<=trie_node_data_items.size() && "invalid data slab" );
+        if (pos+cap==trie_node_data_items.size())
+           {
+            trie_node_data_items.resize(pos); // last slab - simple shrink
+            return;
+           }
+        std::size_t b = data_slab_bucket(cap);
+        if (trie_node_data_free_slabs.size()<=b) trie_node_data_free_slabs.resize(b+1, data_slab_list(trie_node_data_free_slabs.get_allocator()));
+        trie_node_data_free_slabs[b].push_back(pos);
+    }
+
+    #endif
+
+
     // Public utility functions
 
+    // index n must be representable by IndexType, max value is reserved for npos
+    static void check_index_overflow( std::size_t n, const char *what )
+    {
+        if (n >= static_cast<std::size_t>(static_cast<IndexType>(-1)))
+            throw index_overflow_error( std::string("marty::containers::trie: ") + what + " index overflow" );
+    }
+
     value_index add_value_impl( const mapped_type &v)
     {
         if (value_free_indexes.empty())
            {
+            check_index_overflow( values.size(), "value" );
             value_index res = values.size();
             values.push_back(v);
             return res;
@@ -681,10 +1184,21 @@ protected:
 
     // End of Public utility functions
 
+    // empty node, node arrays use trie allocator
+    trie_node new_trie_node() const
+    {
+        #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+        return trie_node();
+        #else
+        return trie_node( typename trie_node::allocator_type( trie_nodes.get_allocator() ) );
+        #endif
+    }
+
     trie_node_index add_trie_node_impl( const trie_node &n)
     {
         if (trie_node_free_indexes.empty())
            {
+            check_index_overflow( trie_nodes.size(), "node" );
             trie_node_index res = trie_nodes.size();
             trie_nodes.push_back(n);
             trie_nodes[res].reserve(reserve_trie_node_data_items);
@@ -709,7 +1223,7 @@ protected:
            }
         else
            {
-            trie_nodes[n].clear(); // = trie_node( ) ; // 0, 0 pos and size == 0 marks node as removed
+            trie_nodes[n].clear(this); // = trie_node( ) ; // 0, 0 pos and size == 0 marks node as removed
             trie_node_free_indexes.push_back(n);
            }
     }
@@ -717,7 +1231,7 @@ protected:
     void remove_node_value( trie_node_index n, trie_node_data_item_index itemIdx )
     {
         MARTY_ADT_TRIE_IMPL_ASSERT( n<trie_nodes.size() && "node index out of range" );
-        MARTY_ADT_TRIE_IMPL_ASSERT( trie_nodes[n].size!=0 && "node allready removed" );
+        MARTY_ADT_TRIE_IMPL_ASSERT( trie_nodes[n].keys_size()!=0 && "node allready removed" );
         trie_nodes[n].remove_item_value( this, itemIdx );
     }
 
@@ -728,39 +1242,18 @@ protected:
         return trie_nodes[n].set_item_value( this, itemIdx, val );
     }
 
+    // dataItemIdx is local node item index
     void remove_data_item( trie_node_data_item_index dataItemIdx, trie_node_index nodeFromIdx /* node from wich remove */)
     {
-        #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
-        // remove item value
-        if (trie_node_data_items[dataItemIdx].value_idx!=value_index_npos)
-           remove_value_impl( trie_node_data_items[dataItemIdx].value_idx );
-        // remove item
-        trie_node_data_items.erase( trie_node_data_items.begin() + dataItemIdx );
-        // adjust node indexes - first_item
-        typename trie_nodes_holder::iterator tnIt = trie_nodes.begin();
-        for(; tnIt != trie_nodes.end(); ++tnIt)
-           {
-            if (!tnIt->size) continue;
-            if ((tnIt - trie_nodes.begin())==nodeFromIdx) continue;
-            if (tnIt->first_item >= dataItemIdx) tnIt->first_item--;
-           }
-        #else
         MARTY_ADT_TRIE_IMPL_ASSERT( nodeFromIdx<trie_nodes.size() && "node index out of range" );
         //trie_nodes[nodeFromIdx].remove_item_value( pt, dataItemIdx );
-        trie_nodes[nodeFromIdx].erase_key_by_index( pt, dataItemIdx );
-        #endif
+        trie_nodes[nodeFromIdx].erase_key_by_index( this, dataItemIdx );
     }
 
     bool is_node_item_or_childs_payloaded( trie_node_index n, trie_node_data_item_index itemIdx ) const
     {
         MARTY_ADT_TRIE_IMPL_ASSERT( n<trie_nodes.size() && "node index out of range" );
-
-        if (trie_nodes[n].is_key_payloaded( this, itemIdx )) return true;
-        if (!trie_nodes[n].key_has_child( this, itemIdx ))   return false;
-
-        trie_node_index childId = trie_nodes[n].get_child_id(this, itemIdx);
-        MARTY_ADT_TRIE_IMPL_ASSERT( childId<trie_nodes.size() && "node index out of range" );
-        return trie_nodes[childId].is_keys_payloaded( this );
+        return trie_nodes[n].get_data_item( this, itemIdx ).payload_count!=0;
 
         #if 0
         MARTY_ADT_TRIE_IMPL_ASSERT( n<trie_nodes.size() && "node index out of range" );
@@ -783,44 +1276,33 @@ protected:
         #endif
     }
 
+    // removes item with its whole subtree, subtree nodes are taken from explicit stack - long keys can't overflow call stack
     void remove_node_item( trie_node_index n, trie_node_data_item_index itemIdx )
     {
-        #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
-        MARTY_ADT_TRIE_IMPL_ASSERT( n<trie_nodes.size() && "node index out of range" );
-        MARTY_ADT_TRIE_IMPL_ASSERT( trie_nodes[n].size!=0 && "node allready removed" );
-        MARTY_ADT_TRIE_IMPL_ASSERT( itemIdx<trie_nodes[n].size && "node item index out of range" );
-
-        trie_node_data_item_index dataItemIdx = trie_nodes[n].first_item + itemIdx;
-        trie_node_index childIdx = trie_node_data_items[dataItemIdx].child_idx;
-        if (childIdx!=trie_node_index_npos) // has child?
-           { 
-            // remove child items
-            while( trie_nodes[childIdx].size )
-               {
-                remove_node_item( childIdx, 0 );
-               }
-            // remove child itself
-            trie_nodes[n].clear(); //  = trie_node( 0, 0 );
-            trie_node_free_indexes.push(n);
-           }
-
-        remove_data_item( trie_nodes[n].first_item + itemIdx, n );
-        #else
         MARTY_ADT_TRIE_IMPL_ASSERT( n<trie_nodes.size() && "node index out of range" );
+        std::vector<trie_node_index> stack;
         if (trie_nodes[n].key_has_child( this, itemIdx ))
+            stack.push_back( trie_nodes[n].get_child_id(this, itemIdx) );
+        trie_nodes[n].erase_key_by_index(this, itemIdx);
+
+        while(!stack.empty())
            {
-            trie_node_index childId = trie_nodes[n].get_child_id(this, itemIdx);
+            trie_node_index childId = stack.back();
+            stack.pop_back();
             MARTY_ADT_TRIE_IMPL_ASSERT( childId<trie_nodes.size() && "node index out of range" );
-            while( trie_nodes[childId].keys_size() )
+
+            trie_node_data_item_index idx = 0, s = trie_nodes[childId].keys_size();
+            for(; idx!=s; ++idx)
                {
-                remove_node_item( childId, 0 );
+                if (trie_nodes[childId].key_has_child( this, idx ))
+                    stack.push_back( trie_nodes[childId].get_child_id(this, idx) );
+                trie_nodes[childId].remove_item_value( this, idx );
                }
+
             // remove child itself
-            trie_nodes[n].clear();// = trie_node( );
-            trie_node_free_indexes.push(n);
+            trie_nodes[childId].clear(this);
+            trie_node_free_indexes.push_back(childId);
            }
-        trie_nodes[n].erase_key_by_index(this, itemIdx);
-        #endif
     }
 
 public:
@@ -837,20 +1319,36 @@ public:
         , trie_node_free_indexes()
         #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
         , trie_node_data_items()
+        , trie_node_data_free_slabs()
         #endif
         , trie_nodes()
         , reserve_trie_node_data_items(1)
         {}
 
-    trie(const Traits &t)
-        : comparator(t)
-        , values()
-        , value_free_indexes()
-        , trie_node_free_indexes()
+    explicit
+    trie(const allocator_type &a)
+        : comparator()
+        , values(a)
+        , value_free_indexes(a)
+        , trie_node_free_indexes(a)
         #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
-        , trie_node_data_items()
+        , trie_node_data_items(a)
+        , trie_node_data_free_slabs(a)
         #endif
-        , trie_nodes()
+        , trie_nodes(a)
+        , reserve_trie_node_data_items(1)
+        {}
+
+    trie(const Traits &t, const allocator_type &a = allocator_type())
+        : comparator(t)
+        , values(a)
+        , value_free_indexes(a)
+        , trie_node_free_indexes(a)
+        #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+        , trie_node_data_items(a)
+        , trie_node_data_free_slabs(a)
+        #endif
+        , trie_nodes(a)
         , reserve_trie_node_data_items(1)
         {}
 
@@ -861,11 +1359,31 @@ public:
         , trie_node_free_indexes(t.trie_node_free_indexes)
         #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
         , trie_node_data_items(t.trie_node_data_items)
+        , trie_node_data_free_slabs(t.trie_node_data_free_slabs)
         #endif
         , trie_nodes(t.trie_nodes)
         , reserve_trie_node_data_items(t.reserve_trie_node_data_items)
         {}
 
+    //! Копия, размещённая аллокатором a
+    trie( const trie &t, const allocator_type &a)
+        : comparator(t.comparator)
+        , values(t.values, a)
+        , value_free_indexes(t.value_free_indexes, a)
+        , trie_node_free_indexes(t.trie_node_free_indexes, a)
+        #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+        , trie_node_data_items(t.trie_node_data_items, a)
+        , trie_node_data_free_slabs(t.trie_node_data_free_slabs, a)
+        #endif
+        , trie_nodes(t.trie_nodes, a)
+        , reserve_trie_node_data_items(t.reserve_trie_node_data_items)
+        {}
+
+    allocator_type get_allocator() const
+    {
+        return allocator_type( values.get_allocator() );
+    }
+
     const_iterator begin() const;
     iterator begin();
 
@@ -895,6 +1413,7 @@ public:
         trie_node_free_indexes .swap(t.trie_node_free_indexes);
         #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
         trie_node_data_items   .swap(t.trie_node_data_items  );
+        trie_node_data_free_slabs.swap(t.trie_node_data_free_slabs);
         #endif
         trie_nodes             .swap(t.trie_nodes            );
     }
@@ -910,6 +1429,11 @@ public:
         reserve_trie_node_data_items = ri;
     }
 
+    //! Перестраивает хранилище узлов и значений в порядке обхода в глубину, освобождая дыры от удалённых элементов
+    /*! Индексы узлов и значений перенумеровываются, списки свободных индексов очищаются. Все итераторы становятся недействительными.
+     */
+    void compact();
+
     bool next( const_iterator &it, const key_type &k ) const;
     bool next( iterator &it, const key_type &k ) const;
 
@@ -925,6 +1449,63 @@ public:
     iterator       find(                          key_type k );
     iterator       find(       iterator findFrom, key_type k );
 
+    //! Точечный поиск без построения итератора, возвращает указатель на значение или 0, если ключа нет
+    template<typename KeyIter>  const mapped_type* lookup( KeyIter b, const KeyIter &e ) const;
+    template<typename KeyIter>  mapped_type*       lookup( KeyIter b, const KeyIter &e );
+
+    //! Поиск наибольшего префикса [b,e), имеющего полезную нагрузку; итератор не строится
+    template<typename KeyIter>  const_match_result longest_match( KeyIter b, const KeyIter &e ) const;
+    template<typename KeyIter>  match_result       longest_match( KeyIter b, const KeyIter &e );
+
+    //! Разбор [b,e) на лексемы по наибольшему совпадению (maximal munch)
+    /*! Для каждой лексемы вызывается h(tokenBegin, length, value); для элемента ключа, с которого не начинается
+        ни одна лексема, вызывается h(pos, 1, 0). Возвращает количество найденных лексем.
+     */
+    template<typename KeyIter, typename Handler>
+    size_type tokenize( KeyIter b, const KeyIter &e, Handler h ) const;
+
+    //! Нечёткий поиск: ключи с полезной нагрузкой на расстоянии Левенштейна не больше maxDistance от [b,e)
+    /*! Для каждого найденного ключа вызывается h(const const_iterator &it, distance), ключи сообщаются в порядке обхода.
+        Обход ведёт по строке динамического программирования на каждый уровень trie и не заходит в поддерево,
+        как только минимум строки превышает maxDistance. Возвращает количество найденных ключей.
+     */
+    template<typename KeyIter, typename Handler>
+    size_type fuzzy_find( KeyIter b, const KeyIter &e, size_type maxDistance, Handler h ) const;
+
+    //! Обход trie совместно с детерминированным автоматом (например, trie_pattern из trie_pattern.h)
+    /*! Automaton должен предоставлять state_type, ranges_holder (отсортированные непересекающиеся пары [first,second]),
+        start(), next(state,key), is_dead(state), is_accepting(state) и live_ranges(state) - диапазоны ключей,
+        переход по которым не ведёт в тупик. В узле просматриваются только элементы из live_ranges,
+        в поддерево, для которого автомат в тупике, обход не заходит.
+        Для каждого ключа с полезной нагрузкой, допускаемого автоматом, вызывается h(const const_iterator &it).
+        Возвращает количество найденных ключей.
+     */
+    template<typename Automaton, typename Handler>
+    size_type match_automaton( const Automaton &a, Handler h ) const;
+
+    //! Диапазон [first,second) всех позиций с префиксом [b,e), включая сам префикс; соседние поддеревья не просматриваются
+    template<typename KeyIter>  std::pair<const_iterator,const_iterator> prefix_range( const KeyIter &b, const KeyIter &e ) const;
+    template<typename KeyIter>  std::pair<iterator,iterator>             prefix_range( const KeyIter &b, const KeyIter &e );
+
+    //! Количество ключей с полезной нагрузкой, начинающихся с [b,e), за O(|prefix|)
+    template<typename KeyIter>  size_type count_prefix( const KeyIter &b, const KeyIter &e ) const;
+
+    //! Первая позиция, ключ которой не меньше (upper_bound - больше) [b,e) в лексикографическом порядке
+    template<typename KeyIter>  const_iterator lower_bound( const KeyIter &b, const KeyIter &e ) const;
+    template<typename KeyIter>  iterator       lower_bound( const KeyIter &b, const KeyIter &e );
+    template<typename KeyIter>  const_iterator upper_bound( const KeyIter &b, const KeyIter &e ) const;
+    template<typename KeyIter>  iterator       upper_bound( const KeyIter &b, const KeyIter &e );
+
+    template<typename KeyIter>  std::pair<const_iterator,const_iterator> equal_range( const KeyIter &b, const KeyIter &e ) const;
+    template<typename KeyIter>  std::pair<iterator,iterator>             equal_range( const KeyIter &b, const KeyIter &e );
+
+    //! Позиция k-го (с нуля) в порядке обхода ключа с полезной нагрузкой, end(), если k>=values_size(); O(глубина * ширина узла)
+    const_iterator nth( size_type k ) const;
+    iterator       nth( size_type k );
+
+    //! Количество ключей с полезной нагрузкой, меньших [b,e)
+    template<typename KeyIter>  size_type rank( KeyIter b, const KeyIter &e ) const;
+
 
     iterator insert( iterator where, const key_type &k );
     iterator insert( iterator where, const key_type &k, const mapped_type &v);
@@ -941,6 +1522,14 @@ public:
     template<typename KeyIter>
     iterator insert( iterator where, const KeyIter &b, const KeyIter &e, const mapped_type &v );
 
+    //! Строит trie заново по последовательности пар ключ/значение, отсортированной по key_compare
+    /*! Требуется ForwardIterator, последовательность проходится дважды: сначала считается размер каждого узла,
+        затем узлы заполняются без поиска и сдвигов. Общий префикс с предыдущим ключом не обходится повторно.
+        Для одинаковых ключей сохраняется последнее значение.
+     */
+    template<typename PairIter>
+    void assign_sorted( PairIter first, PairIter last );
+
     iterator erase( iterator what );
     //iterator erase( iterator where, const key_type &k );
 
@@ -975,6 +1564,12 @@ public:
         {
          //if (tnIt->data_items.em)
          nodesDataSize += sizeof(tnIt->data_items) + tnIt->data_items.capacity() *sizeof(trie_node_data_item);
+         #if defined(USE_MARTY_ADT_TRIE_SPLIT_NODE_KEYS)
+         nodesDataSize += sizeof(tnIt->keys) + tnIt->keys.capacity() *sizeof(key_type);
+         #endif
+         #if defined(USE_MARTY_ADT_TRIE_ADAPTIVE_NODES)
+         nodesDataSize += sizeof(tnIt->byte_index) + tnIt->byte_index.capacity();
+         #endif
         }
      #endif
 
@@ -983,6 +1578,7 @@ public:
           + sizeof(trie_node_free_index_holder)  + trie_node_free_indexes.capacity()*sizeof(trie_node_index)
           #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
           + sizeof(trie_node_data_item_holder)   + trie_node_data_items.capacity()*sizeof(trie_node_data_item)
+          + sizeof(trie_node_data_free_slabs)    + trie_node_data_free_slabs_used_mem()
           #else
           + nodesDataSize
           #endif
@@ -1002,6 +1598,19 @@ protected:
     template<typename Iter>
     void construct_last( Iter &b, trie_node_index nodeIdx = trie_node_index_npos) const;
 
+    bool is_equal_keys( const key_type &k1, const key_type &k2 ) const
+    {
+        return !comparator(k1,k2) && !comparator(k2,k1);
+    }
+
+    template<typename KeyIter>
+    size_type common_prefix_len( KeyIter b1, const KeyIter &e1, KeyIter b2, const KeyIter &e2 ) const
+    {
+        size_type len = 0;
+        for(; b1!=e1 && b2!=e2 && is_equal_keys(*b1, *b2); ++b1, ++b2, ++len) {}
+        return len;
+    }
+
     trie_node_data_item_index find_or_insert_key( const key_type &k, trie_node_index nodeIdx )
     {
         MARTY_ADT_TRIE_IMPL_ASSERT( nodeIdx!=trie_node_index_npos && "invalid node index" );
@@ -1009,27 +1618,420 @@ protected:
         trie_node &node = trie_nodes[nodeIdx];
 
         bool bFound = false;
-        trie_node_data_item_holder::iterator foundIt = node.find_key( this, k, bFound );
+        typename trie_node_data_item_holder::iterator foundIt = node.find_key( this, k, bFound );
         trie_node_data_item_index new_pos_index = node.nodeDataIteratorToLocalIndex(this,foundIt);
         if (bFound) 
            return new_pos_index;
 
         node.insert_data_item(this, foundIt, k );
+        return new_pos_index;
+    }
 
-        #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
-        // adjust node indexes - first_item
-        typename trie_nodes_holder::iterator tnIt = trie_nodes.begin();
-        for(; tnIt != trie_nodes.end(); ++tnIt)
+
+    // walks nodes by plain indexes, returns value index of payloaded key or value_index_npos
+    template<typename KeyIterator>
+    value_index lookup_impl( KeyIterator keyBegin, const KeyIterator &keyEnd ) const
+    {
+        if (keyBegin==keyEnd || trie_nodes.empty())
+           return value_index_npos;
+
+        trie_node_index nodeIdx = 0;
+        for(;;)
            {
-            if (!tnIt->size) continue;
-            if ((tnIt - trie_nodes.begin())==nodeIdx) continue;
-            if (tnIt->first_item >= new_pos_index) tnIt->first_item++;
+            const trie_node &node = trie_nodes[nodeIdx];
+            if (!node.keys_size())
+               return value_index_npos;
+
+            bool bFound = false;
+            typename trie_node_data_item_holder::const_iterator foundIt = node.lookup_key( this, *keyBegin, bFound );
+            if (!bFound)
+               return value_index_npos;
+
+            if (++keyBegin==keyEnd)
+               return foundIt->value_idx;
+
+            nodeIdx = foundIt->child_idx;
+            if (nodeIdx==trie_node_index_npos)
+               return value_index_npos;
            }
-        //node.size++;
-        #endif
-        return new_pos_index;
     }
 
+    template<typename KeyIterator, typename TrieIterator>
+    std::pair<TrieIterator,TrieIterator> prefix_range_impl( const KeyIterator &keyBegin, const KeyIterator &keyEnd, TrieIterator first, const TrieIterator &last ) const
+    {
+        if (keyBegin==keyEnd)
+           return std::make_pair( first, last );
+
+        first = find_impl( keyBegin, keyEnd, last );
+        if (first.is_end_iter())
+           return std::make_pair( last, last );
+
+        TrieIterator rangeEnd = first;
+        rangeEnd.move_to_next_sibling_impl();
+        return std::make_pair( first, rangeEnd );
+    }
+
+    // descends by payload counters of items
+    template<typename TrieIterator>
+    TrieIterator nth_impl( size_type k, TrieIterator it ) const
+    {
+        if (k>=values_size())
+           return it;
+
+        trie_node_index nodeIdx = 0;
+        for(;;)
+           {
+            const trie_node &node = trie_nodes[nodeIdx];
+            trie_node_data_item_index idx = 0, s = node.keys_size();
+            for(; idx!=s; ++idx)
+               {
+                const trie_node_data_item &item = node.get_data_item( this, idx );
+                if (k<item.payload_count)
+                   break;
+                k -= item.payload_count;
+               }
+
+            MARTY_ADT_TRIE_IMPL_ASSERT( idx!=s && "payload counters are inconsistent" );
+            it.push_pos( nodeIdx, idx );
+
+            const trie_node_data_item &item = node.get_data_item( this, idx );
+            if (item.value_idx!=value_index_npos)
+               {
+                if (!k)
+                   return it;
+                --k;
+               }
+
+            nodeIdx = item.child_idx;
+            MARTY_ADT_TRIE_IMPL_ASSERT( nodeIdx!=trie_node_index_npos && "payload counters are inconsistent" );
+           }
+    }
+
+    // descends by key, on mismatch falls back to next sibling (or next subtree of upper levels)
+    template<typename KeyIterator, typename TrieIterator>
+    TrieIterator bound_impl( KeyIterator keyBegin, const KeyIterator &keyEnd, const TrieIterator &first, TrieIterator last, bool bUpper ) const
+    {
+        if (keyBegin==keyEnd)
+           return first;
+
+        if (trie_nodes.empty() || !trie_nodes[0].keys_size())
+           return last;
+
+        TrieIterator &it = last; // starts as end iterator, path grows while descending
+        trie_node_index nodeIdx = 0;
+        for(;;)
+           {
+            const trie_node &node = trie_nodes[nodeIdx];
+
+            bool bFound = false;
+            typename trie_node_data_item_holder::const_iterator foundIt = node.find_key( this, *keyBegin, bFound );
+            trie_node_data_item_index idx = node.keys_size() ? node.nodeDataIteratorToLocalIndex( this, foundIt ) : 0;
+
+            if (!bFound)
+               {
+                if (idx<node.keys_size())
+                   it.push_pos( nodeIdx, idx );
+                else if (!it.is_end_iter())
+                   it.move_to_next_sibling_impl();
+                return it;
+               }
+
+            it.push_pos( nodeIdx, idx );
+
+            if (++keyBegin==keyEnd)
+               {
+                if (bUpper)
+                   it.move_to_next_impl(); // children of the key are greater than it
+                return it;
+               }
+
+            nodeIdx = node.get_data_item( this, idx ).child_idx;
+            if (nodeIdx==trie_node_index_npos || !trie_nodes[nodeIdx].keys_size())
+               {
+                it.move_to_next_sibling_impl(); // key is longer than any key in this subtree
+                return it;
+               }
+           }
+    }
+
+    // DP rows of fuzzy_find for all levels of the current path. Only the band |j-depth|<=maxDistance is computed,
+    // cells outside are greater than maxDistance anyway, so level keeps only the band with its neighbours -
+    // cells [band_begin(depth), band_begin(depth)+width), O(depth*maxDistance) memory
+    struct fuzzy_find_rows
+    {
+        const std::vector<key_type>  &query;
+        size_type                     maxDistance;
+        size_type                     width;
+        std::vector<size_type>        rows;
+
+        fuzzy_find_rows( const std::vector<key_type> &q, size_type maxDist )
+            : query(q)
+            , maxDistance(maxDist)
+            , width( (maxDist>=q.size() ? q.size() : std::min( q.size(), 2*maxDist+2 )) + 1 )
+            , rows()
+            {}
+
+        size_type  band_begin( size_type depth ) const      { return depth>maxDistance+1 ? depth-maxDistance-1 : 0; }
+        size_type& cell( size_type depth, size_type j )      { return rows[depth*width + j - band_begin(depth)]; }
+    };
+
+    // node of fuzzy_find traversal with items left to visit - all items or the ones matching the query in the band
+    struct fuzzy_find_frame
+    {
+        trie_node_index                              node_idx;
+        size_type                                    depth;
+        bool                                         bAllItems;
+        trie_node_data_item_index                    next;
+        small_vector<trie_node_data_item_index, 8>   items;
+    };
+
+    // Computes row of level depth+1 for edge key pKey (0 - key equal to no query element), returns row minimum
+    size_type fuzzy_find_row( size_type depth, fuzzy_find_rows &r, const key_type *pKey ) const
+    {
+        const size_type m           = r.query.size();
+        const size_type maxDistance = r.maxDistance;
+        const size_type cap         = maxDistance+1;
+        const size_type lo          = depth+1>maxDistance ? depth+1-maxDistance : 1;
+        const size_type hi          = std::min( m, depth+1+maxDistance );
+
+        if (r.rows.size()<(depth+2)*r.width)
+            r.rows.resize((depth+2)*r.width);
+
+        size_type rowMin = depth+1; // column 0
+        if (!r.band_begin(depth+1))
+            r.cell(depth+1, 0) = depth+1;
+        if (lo>1 && lo<=m)
+            r.cell(depth+1, lo-1) = cap;
+
+        for(size_type j=lo; j<=hi; ++j)
+           {
+            size_type d = r.cell(depth, j-1) + ((pKey && is_equal_keys(r.query[j-1], *pKey)) ? 0 : 1);
+            d = std::min( d, r.cell(depth, j)+1   );
+            d = std::min( d, r.cell(depth+1, j-1)+1 );
+            d = std::min( d, cap );
+            r.cell(depth+1, j) = d;
+            rowMin = std::min( rowMin, d );
+           }
+
+        if (hi<m)
+            r.cell(depth+1, hi+1) = cap; // upper neighbour of the band for the next level
+
+        return rowMin;
+    }
+
+    // selects items of the node to visit
+    void fuzzy_find_enter( trie_node_index nodeIdx, size_type depth, fuzzy_find_rows &r, fuzzy_find_frame &f ) const
+    {
+        f.node_idx  = nodeIdx;
+        f.depth     = depth;
+        f.next      = 0;
+        f.items.clear();
+
+        // all keys, equal to no query element in the band, have the same row
+        f.bAllItems = fuzzy_find_row( depth, r, 0 )<=r.maxDistance;
+        if (f.bAllItems)
+            return;
+
+        // otherwise only keys, matching query element on the diagonal of a close enough cell, are passable
+        const size_type m  = r.query.size();
+        const size_type lo = depth+1>r.maxDistance ? depth+1-r.maxDistance : 1;
+        const size_type hi = std::min( m, depth+1+r.maxDistance );
+
+        small_vector<size_type, 8> candidates;
+        for(size_type j=lo; j<=hi; ++j)
+           {
+            if (r.cell(depth, j-1)<=r.maxDistance)
+                candidates.push_back(j-1);
+           }
+
+        // keeps traversal order
+        const std::vector<key_type> &query = r.query;
+        std::sort( candidates.begin(), candidates.end()
+                 , [&]( size_type a, size_type b ) { return comparator(query[a], query[b]); }
+                 );
+
+        const trie_node &node = trie_nodes[nodeIdx];
+        for(size_type c=0; c!=candidates.size(); ++c)
+           {
+            if (c && is_equal_keys(query[candidates[c-1]], query[candidates[c]]))
+                continue;
+
+            trie_node_data_item_index idx = node.find_key_idx( this, query[candidates[c]] );
+            if (idx!=trie_node_data_item_index_npos)
+                f.items.push_back(idx);
+           }
+    }
+
+    // DFS with explicit stack of fuzzy_find_frame, iterator path follows the stack
+    template<typename Handler>
+    void fuzzy_find_impl( fuzzy_find_rows &r, const_iterator &it, Handler &h, size_type &nFound ) const
+    {
+        const size_type m = r.query.size();
+
+        std::vector<fuzzy_find_frame> stack(1);
+        fuzzy_find_enter( 0, 0, r, stack.back() );
+
+        while(!stack.empty())
+           {
+            fuzzy_find_frame &f = stack.back();
+            const trie_node_data_item_index itemsCount = f.bAllItems ? trie_nodes[f.node_idx].keys_size() : (trie_node_data_item_index)f.items.size();
+            if (f.next==itemsCount)
+               {
+                stack.pop_back();
+                if (!stack.empty())
+                    it.pop_pos(); // item which led to the node
+                continue;
+               }
+
+            const trie_node_index           nodeIdx = f.node_idx;
+            const size_type                 depth   = f.depth;
+            const trie_node_data_item_index idx     = f.bAllItems ? f.next : f.items[f.next];
+            ++f.next;
+
+            const trie_node_data_item &item = trie_nodes[nodeIdx].get_data_item( this, idx );
+
+            if (fuzzy_find_row( depth, r, &item.key )>r.maxDistance)
+               continue; // distance only grows on longer keys
+
+            it.push_pos( nodeIdx, idx );
+
+            if (item.value_idx!=value_index_npos && std::min( m, depth+1+r.maxDistance )==m)
+               {
+                const size_type dist = r.cell(depth+1, m);
+                if (dist<=r.maxDistance)
+                   {
+                    h( (const const_iterator&)it, dist );
+                    ++nFound;
+                   }
+               }
+
+            if (item.child_idx!=trie_node_index_npos && trie_nodes[item.child_idx].keys_size())
+               {
+                const trie_node_index childIdx = item.child_idx;
+                stack.push_back( fuzzy_find_frame() ); // f is invalidated here
+                fuzzy_find_enter( childIdx, depth+1, r, stack.back() );
+                continue;
+               }
+
+            it.pop_pos();
+           }
+    }
+
+    // DFS with explicit stack of (node, range cursor, item cursor, DFA state), iterator path follows the stack
+    template<typename Automaton, typename Handler>
+    void match_automaton_impl( const Automaton &a, const typename Automaton::state_type &startState
+                             , const_iterator &it, Handler &h, size_type &nFound
+                             ) const
+    {
+        typedef typename Automaton::state_type     state_type;
+        typedef typename Automaton::ranges_holder  ranges_holder;
+
+        struct match_frame
+        {
+            trie_node_index                          node_idx;
+            state_type                               st;
+            const ranges_holder                     *pRanges;
+            typename ranges_holder::const_iterator   rIt;
+            trie_node_data_item_index                idx;
+            bool                                     bInRange;
+        };
+
+        std::vector<match_frame> stack;
+        const ranges_holder &startRanges = a.live_ranges(startState);
+        stack.push_back( match_frame{ 0, startState, &startRanges, startRanges.begin(), 0, false } );
+
+        while(!stack.empty())
+           {
+            match_frame &f = stack.back();
+            if (f.rIt==f.pRanges->end())
+               {
+                stack.pop_back();
+                if (!stack.empty())
+                    it.pop_pos(); // item which led to the node
+                continue;
+               }
+
+            const trie_node &node = trie_nodes[f.node_idx];
+            if (!f.bInRange)
+               {
+                // first item not less than the range begin
+                bool bFound = false;
+                f.idx      = node.nodeDataIteratorToLocalIndex( this, node.find_key( this, f.rIt->first, bFound ) );
+                f.bInRange = true;
+               }
+
+            if (f.idx==node.keys_size() || comparator(f.rIt->second, node.get_data_item( this, f.idx ).key))
+               {
+                ++f.rIt;
+                f.bInRange = false;
+                continue;
+               }
+
+            const trie_node_index           nodeIdx = f.node_idx;
+            const trie_node_data_item_index idx     = f.idx++;
+            const trie_node_data_item      &item    = node.get_data_item( this, idx );
+
+            const state_type next = a.next( f.st, item.key );
+            if (a.is_dead(next))
+               continue;
+
+            it.push_pos( nodeIdx, idx );
+
+            if (item.value_idx!=value_index_npos && a.is_accepting(next))
+               {
+                h( (const const_iterator&)it );
+                ++nFound;
+               }
+
+            if (item.child_idx!=trie_node_index_npos && trie_nodes[item.child_idx].keys_size())
+               {
+                const ranges_holder &nextRanges = a.live_ranges(next);
+                stack.push_back( match_frame{ item.child_idx, next, &nextRanges, nextRanges.begin(), 0, false } ); // f is invalidated here
+                continue;
+               }
+
+            it.pop_pos();
+           }
+    }
+
+    // walks as lookup_impl, but remembers last payloaded key; matchLen receives its length
+    template<typename KeyIterator>
+    value_index longest_match_impl( KeyIterator keyBegin, const KeyIterator &keyEnd, size_type &matchLen ) const
+    {
+        matchLen = 0;
+
+        value_index     matchIdx = value_index_npos;
+        size_type       depth    = 0;
+        trie_node_index nodeIdx  = 0;
+
+        if (trie_nodes.empty())
+           return matchIdx;
+
+        for(; keyBegin!=keyEnd; ++keyBegin)
+           {
+            const trie_node &node = trie_nodes[nodeIdx];
+            if (!node.keys_size())
+               break;
+
+            bool bFound = false;
+            typename trie_node_data_item_holder::const_iterator foundIt = node.lookup_key( this, *keyBegin, bFound );
+            if (!bFound)
+               break;
+
+            ++depth;
+            if (foundIt->value_idx!=value_index_npos)
+               {
+                matchIdx = foundIt->value_idx;
+                matchLen = depth;
+               }
+
+            nodeIdx = foundIt->child_idx;
+            if (nodeIdx==trie_node_index_npos)
+               break;
+           }
+
+        return matchIdx;
+    }
 
     template<typename KeyIterator, typename TrieIterator>
     TrieIterator find_impl( KeyIterator keyBegin, KeyIterator keyEnd, TrieIterator where ) const
@@ -1043,7 +2045,7 @@ protected:
         if (where.is_end_iter()) // find starts on trie root
            {
             bool bFound = false;
-            trie_node_data_item_holder::const_iterator foundIt = trie_nodes[0].find_key( this, *keyBegin++, bFound );
+            typename trie_node_data_item_holder::const_iterator foundIt = trie_nodes[0].lookup_key( this, *keyBegin++, bFound );
             if (!bFound)
                return non_const_iter_end();
 
@@ -1056,7 +2058,7 @@ protected:
                return non_const_iter_end();
 
             bool bFound = false;
-            trie_node_data_item_holder::const_iterator foundIt = trie_nodes[nextNodeIdx].find_key( this, *keyBegin, bFound );
+            typename trie_node_data_item_holder::const_iterator foundIt = trie_nodes[nextNodeIdx].lookup_key( this, *keyBegin, bFound );
             if (!bFound)
                return non_const_iter_end();
     
@@ -1077,7 +2079,7 @@ protected:
         if (where.is_end_iter()) // find starts on trie root
            {
             bool bFound = false;
-            trie_node_data_item_holder::const_iterator foundIt = trie_nodes[0].find_key( this, keyVal, bFound );
+            typename trie_node_data_item_holder::const_iterator foundIt = trie_nodes[0].lookup_key( this, keyVal, bFound );
             if (!bFound)
                return non_const_iter_end();
 
@@ -1089,7 +2091,7 @@ protected:
             if (nextNodeIdx==trie_node_index_npos) // last pos points to the item without child
                return non_const_iter_end();
             bool bFound = false;
-            trie_node_data_item_holder::const_iterator foundIt = trie_nodes[nextNodeIdx].find_key( this, keyVal, bFound );
+            typename trie_node_data_item_holder::const_iterator foundIt = trie_nodes[nextNodeIdx].lookup_key( this, keyVal, bFound );
             if (!bFound)
                return non_const_iter_end();
 
@@ -1108,11 +2110,51 @@ protected:
         trie_node_free_indexes.clear();
         #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
         trie_node_data_items.clear();
+        trie_node_data_free_slabs.clear();
         #endif
         trie_nodes.clear();
     }
 
 
+    // adds delta to payload counters of all items on the path of iterator
+    template<typename TrieIterator>
+    void update_payload_counts( const TrieIterator &where, bool bAdded )
+    {
+        typename trie_path::const_iterator pit = where.get_pos_list().begin();
+        for(; pit!=where.get_pos_list().end(); ++pit)
+           {
+            trie_node_data_item &item = trie_nodes[pit->node_idx].get_data_item( this, pit->item_idx );
+            if (bAdded)
+               ++item.payload_count;
+            else
+               {
+                MARTY_ADT_TRIE_IMPL_ASSERT( item.payload_count!=0 && "payload counter underflow" );
+                --item.payload_count;
+               }
+           }
+    }
+
+    template<typename TrieIterator>
+    mapped_type& set_path_value( const TrieIterator &where, const mapped_type &val )
+    {
+        bool bWasPayloaded = where.is_payloaded();
+        mapped_type &res = set_node_value( where.get_node_index(), where.get_node_data_index(), val );
+        if (!bWasPayloaded)
+           update_payload_counts( where, true );
+        return res;
+    }
+
+    template<typename TrieIterator>
+    void remove_path_value( const TrieIterator &where )
+    {
+        if (!where.is_payloaded())
+           return;
+        remove_node_value( where.get_node_index(), where.get_node_data_index() );
+        update_payload_counts( where, false );
+    }
+
+    // removes payload, then prunes the highest item of the path which has no payloads in its subtree;
+    // returns position next to erased one (or the same position, if it still has payloaded childs)
     template<typename TrieIterator>
     TrieIterator erase_impl( TrieIterator where )
     {
@@ -1122,15 +2164,52 @@ protected:
             return where;
            }
 
-        trie_node_index             lastNodeIdx   = where.get_node_index();
-        trie_node_data_item_index   dataItemIdx   = where.get_node_data_index();
+        remove_path_value( where );
 
-        remove_node_value( lastNodeIdx, dataItemIdx );
-        if (!is_node_item_or_childs_payloaded(lastNodeIdx, dataItemIdx))
+        typename trie_path::size_type pruneDepth = 0, pathSize = where.pos_size();
+        for(; pruneDepth!=pathSize; ++pruneDepth)
+           {
+            if (!is_node_item_or_childs_payloaded( where.get_pos_list()[pruneDepth].node_idx, where.get_pos_list()[pruneDepth].item_idx ))
+               break;
+           }
+
+        if (pruneDepth==pathSize)
+           return where;
+
+        if (!values_size())
+           {
+            clear_impl(); // last key erased
+            where.clear_pos();
+            return where;
+           }
+
+        trie_position prunePos = where.get_pos_list()[pruneDepth];
+        while(where.pos_size()>pruneDepth)
+           where.pop_pos();
+
+        // subtree has no payloads. After erases only it is a chain of at most depth items, but keys inserted
+        // without value (insert(b,e)) may leave a whole payload-free subtree here, remove_node_item walks it with explicit stack
+        remove_node_item( prunePos.node_idx, prunePos.item_idx );
+
+        if (!trie_nodes[prunePos.node_idx].keys_size())
+           {
+            // last item of the node removed, parent item keeps own payload only
+            MARTY_ADT_TRIE_IMPL_ASSERT( pruneDepth!=0 && "root node can't be empty here" );
+            trie_nodes[prunePos.node_idx].clear(this);
+            trie_node_free_indexes.push_back(prunePos.node_idx);
+            where.get_node_data_item().child_idx = trie_node_index_npos;
+            where.move_to_next_sibling_impl();
+           }
+        else if (prunePos.item_idx)
+           {
+            where.push_pos( prunePos.node_idx, prunePos.item_idx-1 );
+            where.move_to_next_sibling_impl();
+           }
+        else
            {
-            remove_node_item( lastNodeIdx, dataItemIdx );
-            where.pop_pos();
+            where.push_pos( prunePos.node_idx, 0 );
            }
+
         return where;
     }
 
@@ -1147,14 +2226,15 @@ protected:
             trie_node_index newNodeIdx = 0;
             if (trie_nodes.empty() || !trie_nodes[0].keys_size()) // no root node
                {
-                newNodeIdx = add_trie_node_impl( trie_node( ) ); // trie_node_index_npos
+                if (trie_nodes.empty())
+                   newNodeIdx = add_trie_node_impl( new_trie_node( ) ); // trie_node_index_npos
                 trie_nodes[newNodeIdx].insert_data_item( this, *keyBegin++ );
                 where.push_pos( newNodeIdx, 0 );
                 if (pNewInserted) *pNewInserted = true;
                }
             else // has root node
                {
-                if (trie_nodes[newNodeIdx].data_items.capacity()<4) trie_nodes[newNodeIdx].data_items.reserve(4);
+                trie_nodes[newNodeIdx].reserve(4);
                 where.push_pos( newNodeIdx
                               , find_or_insert_key( *keyBegin++, newNodeIdx ) 
                                 //- trie_nodes[newNodeIdx].first_item
@@ -1168,7 +2248,7 @@ protected:
             //trie_node_data_item &dataItem = where.get_node_data_item();
             if (where.get_node_data_item().child_idx==trie_node_index_npos) // add new node
                {
-                trie_node_index newNodeIdx = add_trie_node_impl( trie_node( ) ); // trie_node_index_npos
+                trie_node_index newNodeIdx = add_trie_node_impl( new_trie_node( ) ); // trie_node_index_npos
                 trie_nodes[newNodeIdx].insert_data_item( this, *keyBegin );
                 where.get_node_data_item().child_idx = newNodeIdx;
                 where.push_pos( newNodeIdx , 0 );
@@ -1191,7 +2271,7 @@ protected:
     {
         TrieIterator resIter = insert_key_sequence_impl( keyBegin, keyEnd, where, pNewInserted );
         if (!resIter.is_end_iter())
-           set_node_value( resIter.get_node_index(), resIter.get_node_data_index(), val );
+           set_path_value( resIter, val );
         return resIter;
     }
 
@@ -1200,7 +2280,7 @@ protected:
     {
         TrieIterator resIter = insert_key_sequence_impl( keyBegin, keyEnd, where, pNewInserted );
         if (!resIter.is_end_iter() && !resIter.is_payloaded())
-           set_node_value( resIter.get_node_index(), resIter.get_node_data_index(), mapped_type() );
+           set_path_value( resIter, mapped_type() );
         return resIter;
     }
 
@@ -1224,6 +2304,8 @@ public:
     template < typename KeyType
              , typename ValueType
              , typename Traits
+             , typename IndexType
+             , typename Allocator
              >
     friend class trie_map;
 
@@ -1231,6 +2313,7 @@ public:
     typedef typename trie_type::key_type       key_type;
     typedef typename trie_type::mapped_type    mapped_type;
     typedef typename trie_type::trie_position  trie_position_type;
+    typedef typename trie_type::trie_path      trie_path_type;
 
     typedef typename trie_type::key_compare key_compare;
     //typedef typename trie_type::value_compare value_compare;
@@ -1248,12 +2331,12 @@ protected:
 #endif
 
     trie_type                         *pTrie;
-    std::vector< trie_position_type >  curPos;
+    trie_path_type  curPos;
 
-    const std::vector< trie_position_type >& get_pos_list() const
+    const trie_path_type& get_pos_list() const
         { return curPos; }
 
-    std::vector< trie_position_type >& get_pos_list()
+    trie_path_type& get_pos_list()
         { return curPos; }
 
     typename trie_type::trie_node_index get_node_index( const trie_position_type &pos ) const
@@ -1333,37 +2416,33 @@ protected:
         static_cast<T*>(this)->key_sequence_pop_back( );
     }
 
-    typename std::vector< trie_position_type >::size_type pos_size() const
+    typename trie_path_type::size_type pos_size() const
     {
         return curPos.size();
     }
 
     bool move_to_child( const key_type &k )
     {
-        typename trie_type::trie_node_index nodeIdx = get_node_index();
-        const typename trie_type::trie_node &node = pTrie->trie_nodes[nodeIdx];
-        MARTY_ADT_TRIE_IMPL_ASSERT( node.first_item < pTrie->trie_node_data_items.size() 
-                       && "node data index out of range" );
+        typename trie_type::trie_node_index nodeIdx = 0;
+        if (!is_end_iter())
+           nodeIdx = get_node_data_item().child_idx;
+        else if (pTrie->trie_nodes.empty() || !pTrie->trie_nodes[0].keys_size())
+           return false;
 
-        typename trie_node_data_item_holder::const_iterator itemsBegin = pTrie->trie_node_data_items.begin() + node.first_item;
-        typename trie_node_data_item_holder::const_iterator itemsEnd   = itemsBegin + node.size;
+        if (nodeIdx==trie_type::trie_node_index_npos) return false;
 
-        typename trie_node_data_item_holder::const_iterator itemFound = 
-               ::std::lower_bound( itemsBegin, itemsEnd
-                                 , k, typename trie_type::trie_node_data_item_comparator( pTrie->key_comp() )
-                                 );
-        if (itemFound==itemsEnd) return false;
+        const typename trie_type::trie_node &node = pTrie->trie_nodes[nodeIdx];
+        bool bFound = false;
+        typename trie_type::trie_node_data_item_holder::const_iterator itemFound = node.lookup_key( pTrie, k, bFound );
+        if (!bFound) return false;
 
-        curPos.push_back(trie_position_type( itemFound->child_idx, 0 ));
+        push_pos( nodeIdx, node.nodeDataIteratorToLocalIndex( pTrie, itemFound ) );
         return true;
     }
 
 
     void move_to_next_impl()
     {
-        typename trie_type::trie_node_index nodeIdx = get_node_index();
-
-        const typename trie_type::trie_node &node = pTrie->trie_nodes[nodeIdx];
         //MARTY_ADT_TRIE_IMPL_ASSERT( node.first_item < pTrie->trie_node_data_items.size() 
         //               && "node data index out of range" );
 
@@ -1381,7 +2460,14 @@ protected:
             return;
            }
 
-        typename trie_type::trie_node_data_item_index nodeSize = node.keys_size();//size;
+        move_to_next_sibling_impl();
+    }
+
+    // skips subtree of current position
+    void move_to_next_sibling_impl()
+    {
+        typename trie_type::trie_node_index nodeIdx = get_node_index();
+        typename trie_type::trie_node_data_item_index nodeSize = pTrie->trie_nodes[nodeIdx].keys_size();
 
         // try to go wider
         while(++curPos.back().item_idx >= nodeSize)
@@ -1439,7 +2525,7 @@ protected:
     {
         MARTY_ADT_TRIE_IMPL_ASSERT( pTrie==iter.pTrie && "can't compare iterators from different containers" );
         if (curPos.size()!=iter.curPos.size()) return false;
-        std::vector< trie_position_type >::const_iterator it1 = curPos.begin(), it2 = iter.curPos.begin();
+        typename trie_path_type::const_iterator it1 = curPos.begin(), it2 = iter.curPos.begin();
         for(; it1!=curPos.end(); ++it1, ++it2)
            {
             if (*it1!=*it2) return false;
@@ -1447,11 +2533,11 @@ protected:
         return true;
     }
 
-    bool is_equal( const ref_pair< const trie_type*, const std::vector< trie_position_type > > &data ) const
+    bool is_equal( const ref_pair< const trie_type*, const trie_path_type > &data ) const
     {
         MARTY_ADT_TRIE_IMPL_ASSERT( pTrie==data.first && "can't compare iterators from different containers" );
         if (curPos.size()!=data.second.size()) return false;
-        std::vector< trie_position_type >::const_iterator it1 = curPos.begin(), it2 = data.second.begin();
+        typename trie_path_type::const_iterator it1 = curPos.begin(), it2 = data.second.begin();
         for(; it1!=curPos.end(); ++it1, ++it2)
            {
             if (*it1!=*it2) return false;
@@ -1486,22 +2572,22 @@ public:
     }
 
     /*
-    ref_pair< const trie_type*, const std::vector< trie_position_type > >
+    ref_pair< const trie_type*, const trie_path_type >
     get_base_data() const
     {
-        return ref_pair< const trie_type*, const std::vector< trie_position_type > >( pTrie, curPos );
+        return ref_pair< const trie_type*, const trie_path_type >( pTrie, curPos );
     }
     */
-    ref_pair< trie_type*, std::vector< trie_position_type > >
+    ref_pair< trie_type*, trie_path_type >
     get_base_data() const
     {
-        return ref_pair< trie_type*, std::vector< trie_position_type > >( const_cast< trie_type*& >(pTrie), const_cast< std::vector< trie_position_type >& >(curPos) );
+        return ref_pair< trie_type*, trie_path_type >( const_cast< trie_type*& >(pTrie), const_cast< trie_path_type& >(curPos) );
     }
 
     
     bool is_payloaded() const
     {
-        const trie_type::trie_node_data_item &item = get_node_data_item();
+        const typename trie_type::trie_node_data_item &item = get_node_data_item();
         return (item.value_idx!=trie_type::value_index_npos) ? true : false;
     }
 
@@ -1512,11 +2598,11 @@ public:
          curPos.swap(iter.curPos);
     }
 
-    trie_iterator_base_impl( trie_type *pt, bool bBegin, typename std::vector< trie_position_type >::size_type pos_size = MARTY_ADT_TRIE_ITERATOR_RESERVE_MAGIC_NUMBER )
+    trie_iterator_base_impl( trie_type *pt, bool bBegin, typename trie_path_type::size_type pos_size = 0 )
     : pTrie(pt), curPos()
     {
         if (pTrie->trie_nodes.empty()) return;
-        curPos.reserve(pos_size);
+        if (pos_size) curPos.reserve(pos_size);
         //static_cast<T*>(this)->key_sequence_reserve( pos_size );
         if (bBegin) 
            {
@@ -1532,8 +2618,8 @@ public:
         //static_cast<T*>(this)->key_sequence_reserve( curPos.capacity() );
     }
 
-    //trie_iterator_base_impl( const ref_pair< const trie_type*, const std::vector< trie_position_type > > &data )
-    trie_iterator_base_impl( const ref_pair< trie_type*, std::vector< trie_position_type > > &data )
+    //trie_iterator_base_impl( const ref_pair< const trie_type*, const trie_path_type > &data )
+    trie_iterator_base_impl( const ref_pair< trie_type*, trie_path_type > &data )
     : pTrie(data.first), curPos(data.second)
     {
     }
@@ -1544,8 +2630,8 @@ public:
         trie_iterator_base_impl tmp(iter); swap(tmp);
     }
 
-    //void assign( const ref_pair< const trie_type*, const std::vector< trie_position_type > > &data )
-    void assign( const ref_pair< trie_type*, std::vector< trie_position_type > > &data )
+    //void assign( const ref_pair< const trie_type*, const trie_path_type > &data )
+    void assign( const ref_pair< trie_type*, trie_path_type > &data )
     {
         trie_iterator_base_impl tmp(data); swap(tmp);
     }
@@ -1577,15 +2663,24 @@ protected:
     typedef trie_iterator_base_impl< TrieType
                                    , trie_const_iterator_impl<TrieType>
                                    > base_impl;
-    friend typename base_impl;
+    friend base_impl;
     
     typedef TrieType trie_type;
-    friend  typename trie_type;
+    friend  trie_type;
 
     typedef typename base_impl::key_type            key_type;
     typedef typename base_impl::trie_position_type  trie_position_type;
+    typedef typename base_impl::trie_path_type      trie_path_type;
     typedef typename base_impl::mapped_type         mapped_type;
 
+    using base_impl::pTrie;
+    using base_impl::get_node_data_item;
+    using base_impl::move_to_next_impl;
+    using base_impl::move_to_next_sibling_impl;
+    using base_impl::move_to_prev_impl;
+    using base_impl::is_equal;
+    using base_impl::assign;
+
     //  
     // friend class trie_map;
     //  
@@ -1604,7 +2699,7 @@ protected:
     void key_sequence_push_back( const key_type &k ) { }
     void key_sequence_pop_back( ) {}
 
-    trie_const_iterator_impl( trie_type *pt, bool bBegin, typename std::vector< trie_position_type >::size_type pos_size = MARTY_ADT_TRIE_ITERATOR_RESERVE_MAGIC_NUMBER )
+    trie_const_iterator_impl( trie_type *pt, bool bBegin, typename trie_path_type::size_type pos_size = 0 )
         : base_impl(pt,bBegin,pos_size) {}
 
 public:
@@ -1687,7 +2782,7 @@ public:
     //!!!payload
     const mapped_type& payload() const
     {
-        const trie_type::trie_node_data_item &item = get_node_data_item();
+        const typename trie_type::trie_node_data_item &item = get_node_data_item();
         MARTY_ADT_TRIE_IMPL_ASSERT( (item.value_idx!=trie_type::value_index_npos) && "No payload" );
         return pTrie->values[item.value_idx];
     }
@@ -1696,12 +2791,12 @@ public:
 
     // bool is_payloaded() const
     // {
-    //     const trie_type::trie_node_data_item &item = get_node_data_item();
+    //     const typename trie_type::trie_node_data_item &item = get_node_data_item();
     //     return (item.value_idx!=trie_type::value_index_npos) ? true : false;
     // }
 
     // trie_type                         *pTrie;
-    // std::vector< trie_position_type >  curPos;
+    // trie_path_type  curPos;
 
 
 
@@ -1722,15 +2817,24 @@ protected:
     typedef trie_iterator_base_impl< TrieType
                                    , trie_iterator_impl<TrieType>
                                    > base_impl;
-    friend typename base_impl;
+    friend base_impl;
     
     typedef TrieType trie_type;
-    friend  typename trie_type;
+    friend  trie_type;
 
     typedef typename base_impl::key_type            key_type;
     typedef typename base_impl::trie_position_type  trie_position_type;
+    typedef typename base_impl::trie_path_type      trie_path_type;
     typedef typename base_impl::mapped_type         mapped_type;
 
+    using base_impl::pTrie;
+    using base_impl::get_node_data_item;
+    using base_impl::move_to_next_impl;
+    using base_impl::move_to_next_sibling_impl;
+    using base_impl::move_to_prev_impl;
+    using base_impl::is_equal;
+    using base_impl::assign;
+
     //  
     // friend class trie_map;
     //  
@@ -1748,7 +2852,7 @@ protected:
     void key_sequence_push_back( const key_type &k ) { }
     void key_sequence_pop_back( ) {}
 
-    trie_iterator_impl( trie_type *pt, bool bBegin, typename std::vector< trie_position_type >::size_type pos_size = MARTY_ADT_TRIE_ITERATOR_RESERVE_MAGIC_NUMBER )
+    trie_iterator_impl( trie_type *pt, bool bBegin, typename trie_path_type::size_type pos_size = 0 )
         : base_impl(pt,bBegin,pos_size) {}
 
 public:
@@ -1802,7 +2906,7 @@ public:
     //!!!payload
     mapped_type& payload() const
     {
-        const trie_type::trie_node_data_item &item = get_node_data_item();
+        const typename trie_type::trie_node_data_item &item = get_node_data_item();
         MARTY_ADT_TRIE_IMPL_ASSERT( (item.value_idx!=trie_type::value_index_npos) && "No payload" );
         return pTrie->values[item.value_idx];
     }
@@ -1817,6 +2921,8 @@ public:
 template < typename KeyType
          , typename ValueType
          , typename Traits
+         , typename IndexType
+         , typename Allocator
          >
 class trie_map;
 
@@ -1839,16 +2945,25 @@ protected:
                                    , trie_map_iterator_base_impl<TrieType, TrieKeyTypeContainer>
                                    > base_impl;
     typedef TrieType trie_type;
-    typedef trie_map< TrieKeyTypeContainer, typename trie_type::mapped_type, typename trie_type::key_compare >  trie_map;
+    typedef trie_map< TrieKeyTypeContainer, typename trie_type::mapped_type, typename trie_type::key_compare, typename trie_type::index_type, typename trie_type::allocator_type >  trie_map_type;
 
     typedef typename base_impl::key_type            key_type;
     typedef typename base_impl::trie_position_type  trie_position_type;
+    typedef typename base_impl::trie_path_type      trie_path_type;
     typedef typename base_impl::mapped_type         mapped_type;
 
+    using base_impl::pTrie;
+    using base_impl::curPos;
+    using base_impl::get_node_data_item;
+    using base_impl::is_end_iter;
+    using base_impl::is_payloaded;
+    using base_impl::move_to_next_payloaded_impl;
+    using base_impl::move_to_prev_payloaded_impl;
+
 
-    friend typename trie_type;
-    friend typename base_impl;
-    friend typename trie_map ;
+    friend trie_type;
+    friend base_impl;
+    friend trie_map_type;
 
 
     //---
@@ -1894,14 +3009,14 @@ protected:
          str_key.erase( str_key.begin() + str_key.size() - 1u );
     }
 
-    trie_map_iterator_base_impl( trie_type *pt, bool bBegin, typename std::vector< trie_position_type >::size_type pos_size = MARTY_ADT_TRIE_ITERATOR_RESERVE_MAGIC_NUMBER )
+    trie_map_iterator_base_impl( trie_type *pt, bool bBegin, typename trie_path_type::size_type pos_size = 0 )
         : base_impl(pt,bBegin,pos_size), str_key() {}
 
     void build_str_key()
     {
         str_key.clear();
-        str_key.reserve( curPos.capacity() );
-        std::vector< trie_position_type >::const_iterator cit = curPos.begin();
+        str_key.reserve( curPos.size() );
+        typename trie_path_type::const_iterator cit = curPos.begin();
         for(; cit != curPos.end(); ++cit)
            {
             typename trie_type::trie_node_data_item dataItem = get_node_data_item(*cit);
@@ -1930,8 +3045,8 @@ public:
 
     trie_map_iterator_base_impl( ) : base_impl() { }
 
-    trie_map_iterator_base_impl( const ref_pair< trie_type*, std::vector< trie_position_type > > &data )
-        : base_impl(data), str_key() { adjust_from_trie_iterator(); build_str_key(); }
+    trie_map_iterator_base_impl( const ref_pair< trie_type*, trie_path_type > &data )
+        : base_impl(data), str_key() { build_str_key(); adjust_from_trie_iterator(); }
 
 
     trie_map_iterator_base_impl( const trie_map_iterator_base_impl &i )
@@ -1944,10 +3059,10 @@ public:
         : base_impl(i), str_key(i.str_key) { }
 
     trie_map_iterator_base_impl( const trie_const_iterator_impl<TrieType> &i) 
-        : base_impl(i.get_base_data()) { adjust_from_trie_iterator(); build_str_key(); }
+        : base_impl(i.get_base_data()) { build_str_key(); adjust_from_trie_iterator(); }
 
     trie_map_iterator_base_impl( const trie_iterator_impl<TrieType> &i) 
-        : base_impl(i.get_base_data()) { adjust_from_trie_iterator(); build_str_key(); }
+        : base_impl(i.get_base_data()) { build_str_key(); adjust_from_trie_iterator(); }
 
 
     trie_map_iterator_base_impl& operator=(const trie_map_const_iterator_impl<TrieType,TrieKeyTypeContainer> &i)
@@ -1957,10 +3072,10 @@ public:
         { base_impl::assign(i); str_key = i.str_key; return *this; }
 
     trie_map_iterator_base_impl& operator=(const trie_const_iterator_impl<TrieType> &i)
-        { base_impl::assign(i.get_base_data()); adjust_from_trie_iterator(); build_str_key(); return *this; }
+        { base_impl::assign(i.get_base_data()); build_str_key(); adjust_from_trie_iterator(); return *this; }
 
     trie_map_iterator_base_impl& operator=(const trie_iterator_impl<TrieType> &i)
-        { base_impl::assign(i.get_base_data()); adjust_from_trie_iterator(); build_str_key(); return *this; }
+        { base_impl::assign(i.get_base_data()); build_str_key(); adjust_from_trie_iterator(); return *this; }
 
     void inc() { move_to_next_payloaded_impl(); }
     void dec() { move_to_prev_payloaded_impl(); }
@@ -1973,7 +3088,7 @@ public:
         str_key = i.str_key;
     }
 
-    void assign( const ref_pair< trie_type*, std::vector< trie_position_type > > &data )
+    void assign( const ref_pair< trie_type*, trie_path_type > &data )
     {
         base_impl::assign(data); 
     }
@@ -1995,8 +3110,16 @@ protected:
 
     typedef trie_map_const_iterator_impl< TrieType, TrieKeyTypeContainer>  this_type;
     typedef trie_map_iterator_base_impl< TrieType, TrieKeyTypeContainer>   base_impl;
+    typedef typename base_impl::trie_type    trie_type;
+    typedef typename base_impl::string_type  string_type;
+    typedef typename base_impl::mapped_type  mapped_type;
     friend trie_type;
-    friend class base_impl;
+    friend base_impl;
+
+    using base_impl::str_key;
+    using base_impl::inc;
+    using base_impl::dec;
+    using base_impl::is_equal;
 
 public:
 
@@ -2006,7 +3129,7 @@ public:
     typedef typename trie_type::key_compare key_compare;
     //typedef typename trie_type::value_compare value_compare;
     //typedef typename trie_type::value_type value_type;
-    typedef typename ref_pair_type                     value_type;
+    typedef          ref_pair_type                     value_type;
     typedef typename trie_type::difference_type        difference_type;
 
     typedef          boxed_ptr< ref_pair_type >        pointer;
@@ -2039,9 +3162,9 @@ public:
     bool operator!=(const this_type &i) const  { return !is_equal(i); }
 
     const boxed_ptr< ref_pair_type > operator->() const 
-        { return boxed_ptr< ref_pair_type >( ref_pair_type(str_key, get_value_ref() ) ); }
+        { return boxed_ptr< ref_pair_type >( ref_pair_type(str_key, this->get_value_ref() ) ); }
     const ref_pair_type              
-        operator* () const { return ref_pair_type(str_key, get_value_ref() ); }
+        operator* () const { return ref_pair_type(str_key, this->get_value_ref() ); }
 
 }; // class trie_map_const_iterator_impl
 
@@ -2058,8 +3181,16 @@ protected:
 
     typedef trie_map_iterator_impl< TrieType, TrieKeyTypeContainer>  this_type;
     typedef trie_map_iterator_base_impl< TrieType, TrieKeyTypeContainer> base_impl;
+    typedef typename base_impl::trie_type    trie_type;
+    typedef typename base_impl::string_type  string_type;
+    typedef typename base_impl::mapped_type  mapped_type;
     friend trie_type;
-    friend class base_impl;
+    friend base_impl;
+
+    using base_impl::str_key;
+    using base_impl::inc;
+    using base_impl::dec;
+    using base_impl::is_equal;
     friend class trie_map_const_iterator_impl< TrieType, TrieKeyTypeContainer >;
 
 public:
@@ -2068,7 +3199,7 @@ public:
 
 
     typedef typename trie_type::key_compare key_compare;
-    typedef typename ref_pair_type                     value_type;
+    typedef          ref_pair_type                     value_type;
     typedef typename trie_type::difference_type        difference_type;
     typedef          boxed_ptr< ref_pair_type >        pointer;
     typedef          ref_pair_type                     reference;
@@ -2093,9 +3224,9 @@ public:
     bool operator!=(const this_type &i) const  { return !is_equal(i); }
 
     boxed_ptr< ref_pair_type > operator->() const 
-        { return boxed_ptr< ref_pair_type >( ref_pair_type(str_key, get_value_ref() ) ); }
+        { return boxed_ptr< ref_pair_type >( ref_pair_type(str_key, this->get_value_ref() ) ); }
     ref_pair_type operator* () const 
-        { return ref_pair_type(str_key, get_value_ref() ); }
+        { return ref_pair_type(str_key, this->get_value_ref() ); }
 
 }; // class trie_map_iterator_impl
 
@@ -2107,10 +3238,10 @@ public:
 
 
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 template<typename Iter>
 inline void
-trie<KeyType,ValueType,Traits > :: construct_last( Iter &iter, typename trie<KeyType,ValueType,Traits > ::trie_node_index nodeIdx ) const
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: construct_last( Iter &iter, typename trie<KeyType,ValueType,Traits,IndexType,Allocator > ::trie_node_index nodeIdx ) const
 {
     //iter.clear_pos();
     if (nodeIdx==trie_node_index_npos)
@@ -2130,252 +3261,679 @@ trie<KeyType,ValueType,Traits > :: construct_last( Iter &iter, typename trie<Key
 }
 
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline
-typename trie<KeyType,ValueType,Traits > :: const_iterator
-trie<KeyType,ValueType,Traits > :: begin() const
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: begin() const
 {
-    return typename trie<KeyType,ValueType,Traits > :: const_iterator( const_cast< trie<KeyType,ValueType,Traits >* >(this), true );
+    return typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator( const_cast< trie<KeyType,ValueType,Traits,IndexType,Allocator >* >(this), true );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline
-typename trie<KeyType,ValueType,Traits > :: iterator
-trie<KeyType,ValueType,Traits > :: begin()
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: begin()
 {
-    return typename trie<KeyType,ValueType,Traits > :: iterator( this, true );
+    return typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator( this, true );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline
-typename trie<KeyType,ValueType,Traits > :: const_iterator
-trie<KeyType,ValueType,Traits > :: end() const
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: end() const
 {
-    return typename trie<KeyType,ValueType,Traits > :: const_iterator( const_cast< trie<KeyType,ValueType,Traits >* >(this), false );
+    return typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator( const_cast< trie<KeyType,ValueType,Traits,IndexType,Allocator >* >(this), false );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline
-typename trie<KeyType,ValueType,Traits > :: iterator
-trie<KeyType,ValueType,Traits > :: end()
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: end()
 {
-    return typename trie<KeyType,ValueType,Traits > :: iterator( this, false );
+    return typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator( this, false );
 }
 
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline
-typename trie<KeyType,ValueType,Traits > :: iterator
-trie<KeyType,ValueType,Traits > :: non_const_iter_end() const
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: non_const_iter_end() const
 {
-    return typename trie<KeyType,ValueType,Traits > :: iterator( const_cast< trie<KeyType,ValueType,Traits >* >(this), false );
+    return typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator( const_cast< trie<KeyType,ValueType,Traits,IndexType,Allocator >* >(this), false );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline bool
-trie<KeyType,ValueType,Traits > :: next( typename trie<KeyType,ValueType,Traits > :: const_iterator &it
-                                       , const typename trie<KeyType,ValueType,Traits > :: key_type &k
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: next( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator &it
+                                       , const typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: key_type &k
                                        ) const
 {
-    return it->move_to_child( k );
+    return it.move_to_child( k );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline bool
-trie<KeyType,ValueType,Traits > :: next( typename trie<KeyType,ValueType,Traits > :: iterator &it
-                                       , const typename trie<KeyType,ValueType,Traits > :: key_type &k
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: next( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator &it
+                                       , const typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: key_type &k
                                        ) const
 {
-    return it->move_to_child( k );
+    return it.move_to_child( k );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline
-typename trie<KeyType,ValueType,Traits > :: iterator
-trie<KeyType,ValueType,Traits > :: 
-insert( typename trie<KeyType,ValueType,Traits > :: iterator where
-      , const typename trie<KeyType,ValueType,Traits > :: key_type &k )
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
+insert( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator where
+      , const typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: key_type &k )
 {
-    return pTrie->insert_key_sequence_impl( (&k), ((&k)+1), where );
+    return insert_key_sequence_impl( (&k), ((&k)+1), where );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline
-typename trie<KeyType,ValueType,Traits > :: iterator
-trie<KeyType,ValueType,Traits > :: 
-insert( typename trie<KeyType,ValueType,Traits > :: iterator where
-      , const typename trie<KeyType,ValueType,Traits > :: key_type &k
-      , const typename trie<KeyType,ValueType,Traits > :: mapped_type &v )
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
+insert( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator where
+      , const typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: key_type &k
+      , const typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: mapped_type &v )
 {
-    return pTrie->insert_key_sequence_impl( (&k), ((&k)+1), where, v );
+    return insert_key_sequence_impl( (&k), ((&k)+1), where, v );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 template<typename KeyIter>
 inline
-typename trie<KeyType,ValueType,Traits > :: iterator
-trie<KeyType,ValueType,Traits > :: 
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
 insert( const KeyIter &b, const KeyIter &e )
 {
-    return insert_key_sequence_impl( b, e, typename trie<KeyType,ValueType,Traits > :: iterator( this, false ) );
+    return insert_key_sequence_impl( b, e, typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator( this, false ) );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 template<typename KeyIter>
 inline
-typename trie<KeyType,ValueType,Traits > :: iterator
-trie<KeyType,ValueType,Traits > :: 
-insert( typename trie<KeyType,ValueType,Traits > :: iterator where
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
+insert( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator where
       , const KeyIter &b, const KeyIter &e )
 {
     return insert_key_sequence_impl( b, e, where );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 template<typename KeyIter>
 inline
-typename trie<KeyType,ValueType,Traits > :: iterator
-trie<KeyType,ValueType,Traits > :: 
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
 insert( const KeyIter &b, const KeyIter &e
-      , const typename trie<KeyType,ValueType,Traits > :: mapped_type &v )
+      , const typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: mapped_type &v )
 {
-    return insert_key_sequence_impl( b, e, typename trie<KeyType,ValueType,Traits > :: iterator( this, false ), v );
+    return insert_key_sequence_impl( b, e, typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator( this, false ), v );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 template<typename KeyIter>
 inline
-typename trie<KeyType,ValueType,Traits > :: iterator
-trie<KeyType,ValueType,Traits > :: 
-insert( typename trie<KeyType,ValueType,Traits > :: iterator where
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
+insert( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator where
       , const KeyIter &b, const KeyIter &e
-      , const typename trie<KeyType,ValueType,Traits > :: mapped_type &v )
+      , const typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: mapped_type &v )
 {
-    return pTrie->insert_key_sequence_impl( b, e, where, v );
+    return insert_key_sequence_impl( b, e, where, v );
 }
 
 
-template < typename KeyType, typename ValueType, typename Traits >     template<typename KeyIter>   inline
-typename trie<KeyType,ValueType,Traits > :: const_iterator 
-trie<KeyType,ValueType,Traits > :: find( const KeyIter &b, const KeyIter &e ) const
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
+template<typename PairIter>
+inline void
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
+assign_sorted( PairIter first, PairIter last )
 {
-    return find_impl( b, e, typename trie<KeyType,ValueType,Traits > :: const_iterator( this, false ) );
+    clear_impl();
+
+    // Pass 1 - count items in each node. Nodes are numbered in creation order, root is 0
+    std::vector<trie_node_data_item_index> nodeSizes;
+    std::vector<trie_node_index>           pathNodes;
+    size_type                              keysCount = 0;
+
+    PairIter prev = last;
+    size_type prevLen = 0;
+    for(PairIter it=first; it!=last; ++it)
+       {
+        const size_type keyLen = static_cast<size_type>(std::distance(it->first.begin(), it->first.end()));
+        if (!keyLen) continue;
+
+        const size_type lcp = (prev==last) ? 0 : common_prefix_len(prev->first.begin(), prev->first.end(), it->first.begin(), it->first.end());
+        if (lcp==keyLen && lcp==prevLen) { prev = it; continue; } // duplicate key
+
+        MARTY_ADT_TRIE_IMPL_ASSERT( lcp<keyLen && "keys must be sorted" );
+        MARTY_ADT_TRIE_IMPL_ASSERT( (lcp==prevLen || comparator(*std::next(prev->first.begin(), lcp), *std::next(it->first.begin(), lcp))) && "keys must be sorted" );
+
+        if (pathNodes.size()<keyLen) pathNodes.resize(keyLen);
+        for(size_type d=lcp; d!=keyLen; ++d)
+           {
+            if (d==lcp && d<prevLen)
+               {
+                check_index_overflow( std::size_t(nodeSizes[pathNodes[d]])+1, "node data item" );
+                ++nodeSizes[pathNodes[d]];
+               }
+            else
+               {
+                check_index_overflow( nodeSizes.size(), "node" );
+                pathNodes[d] = nodeSizes.size();
+                nodeSizes.push_back(1);
+               }
+           }
+
+        check_index_overflow( keysCount, "value" );
+        ++keysCount;
+        prev = it; prevLen = keyLen;
+       }
+
+    if (nodeSizes.empty())
+       return;
+
+    // Allocate exact node storage
+    trie_nodes.resize(nodeSizes.size(), new_trie_node());
+    #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+    std::size_t totalItems = 0;
+    for(trie_node_index n=0; n!=nodeSizes.size(); ++n)
+       {
+        trie_nodes[n] = trie_node( static_cast<trie_node_data_item_index>(totalItems), 0, nodeSizes[n] );
+        totalItems += nodeSizes[n];
+        check_index_overflow( totalItems, "node data item" );
+       }
+    trie_node_data_items.resize(totalItems);
+    #else
+    for(trie_node_index n=0; n!=nodeSizes.size(); ++n)
+        trie_nodes[n].reserve(nodeSizes[n]);
+    #endif
+    values.reserve(keysCount);
+
+    // Pass 2 - fill nodes in order, no search and no shifts
+    std::vector<trie_node_data_item_index> pathItems;
+    trie_node_index nextNodeIdx = 0;
+
+    prev = last; prevLen = 0;
+    for(PairIter it=first; it!=last; ++it)
+       {
+        const size_type keyLen = static_cast<size_type>(std::distance(it->first.begin(), it->first.end()));
+        if (!keyLen) continue;
+
+        const size_type lcp = (prev==last) ? 0 : common_prefix_len(prev->first.begin(), prev->first.end(), it->first.begin(), it->first.end());
+        if (lcp==keyLen && lcp==prevLen) // duplicate key - last value wins
+           {
+            set_node_value( pathNodes[keyLen-1], pathItems[keyLen-1], it->second );
+            prev = it;
+            continue;
+           }
+
+        if (pathItems.size()<keyLen) pathItems.resize(keyLen);
+
+        auto keyIt = std::next(it->first.begin(), lcp);
+        for(size_type d=lcp; d!=keyLen; ++d, ++keyIt)
+           {
+            if (!(d==lcp && d<prevLen))
+               {
+                pathNodes[d] = nextNodeIdx++;
+                if (d)
+                    trie_nodes[pathNodes[d-1]].get_data_item( this, pathItems[d-1] ).child_idx = pathNodes[d];
+               }
+            pathItems[d] = trie_nodes[pathNodes[d]].append_data_item( this, *keyIt );
+           }
+
+        trie_nodes[pathNodes[keyLen-1]].get_data_item( this, pathItems[keyLen-1] ).value_idx = add_value_impl( it->second );
+        for(size_type d=0; d!=keyLen; ++d)
+            ++trie_nodes[pathNodes[d]].get_data_item( this, pathItems[d] ).payload_count;
+
+        prev = it; prevLen = keyLen;
+       }
+
+    MARTY_ADT_TRIE_IMPL_ASSERT( nextNodeIdx==trie_nodes.size() && "nodes count mismatch" );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >     template<typename KeyIter>   inline
-typename trie<KeyType,ValueType,Traits > :: const_iterator 
-trie<KeyType,ValueType,Traits > :: find( typename trie<KeyType,ValueType,Traits > :: const_iterator findFrom, const KeyIter &b, const KeyIter &e ) const
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
+inline void
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: compact()
+{
+    if (trie_nodes.empty() || !trie_nodes[0].keys_size())
+       {
+        clear_impl();
+        values.shrink_to_fit();
+        trie_nodes.shrink_to_fit();
+        #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+        trie_node_data_items.shrink_to_fit();
+        #endif
+        return;
+       }
+
+    trie_nodes_holder newNodes ( trie_nodes.get_allocator() );
+    values_holder     newValues( values.get_allocator() );
+    newNodes .reserve( trie_nodes.size() - trie_node_free_indexes.size() );
+    newValues.reserve( values_size() );
+
+    #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+    trie_node_data_item_holder newItems( trie_node_data_items.get_allocator() );
+    newItems.reserve( trie_node_data_items.size() );
+    #endif
+
+    // nodes are moved to newNodes when first entered, items are patched there in iteration order,
+    // so node numbers and value numbers both follow DFS preorder
+    std::vector< trie_position > stack;
+
+    newNodes.push_back( std::move(trie_nodes[0]) );
+    #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+    newNodes.back().relocate_items( this, newItems );
+    #else
+    newNodes.back().shrink_to_fit();
+    #endif
+    stack.push_back( trie_position( 0, 0 ) );
+
+    while(!stack.empty())
+       {
+        trie_position &top = stack.back();
+        if (top.item_idx==newNodes[top.node_idx].keys_size())
+           {
+            stack.pop_back();
+            continue;
+           }
+
+        trie_node_index           curNodeIdx = top.node_idx;
+        trie_node_data_item_index curItemIdx = top.item_idx++;
+
+        #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+        trie_node_data_item &item = newItems[ newNodes[curNodeIdx].first_item + curItemIdx ];
+        #else
+        trie_node_data_item &item = newNodes[curNodeIdx].data_items[curItemIdx];
+        #endif
+
+        if (item.value_idx!=value_index_npos)
+           {
+            value_index newValueIdx = (value_index)newValues.size();
+            newValues.push_back( std::move(values[item.value_idx]) );
+            item.value_idx = newValueIdx;
+           }
+
+        if (item.child_idx!=trie_node_index_npos && !trie_nodes[item.child_idx].keys_size())
+           item.child_idx = trie_node_index_npos; // empty child left by erase is dropped
+
+        if (item.child_idx!=trie_node_index_npos)
+           {
+            trie_node_index oldChildIdx = item.child_idx;
+            trie_node_index newChildIdx = (trie_node_index)newNodes.size();
+            item.child_idx = newChildIdx; // item reference is not used after newNodes/newItems grow
+
+            newNodes.push_back( std::move(trie_nodes[oldChildIdx]) );
+            #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+            newNodes.back().relocate_items( this, newItems );
+            #else
+            newNodes.back().shrink_to_fit();
+            #endif
+            stack.push_back( trie_position( newChildIdx, 0 ) );
+           }
+       }
+
+    newNodes .shrink_to_fit();
+    newValues.shrink_to_fit();
+
+    trie_nodes.swap( newNodes );
+    values    .swap( newValues );
+
+    value_free_index_holder( value_free_indexes.get_allocator() ).swap( value_free_indexes );
+    trie_node_free_index_holder( trie_node_free_indexes.get_allocator() ).swap( trie_node_free_indexes );
+
+    #if defined(USE_MARTY_ADT_TRIE_SINGLE_DATA_ARRAY)
+    newItems.shrink_to_fit();
+    trie_node_data_items.swap( newItems );
+    data_slab_lists( trie_node_data_free_slabs.get_allocator() ).swap( trie_node_data_free_slabs );
+    #endif
+}
+
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: find( const KeyIter &b, const KeyIter &e ) const
+{
+    return find_impl( b, e, typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator( const_cast< trie<KeyType,ValueType,Traits,IndexType,Allocator >* >(this), false ) );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: find( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator findFrom, const KeyIter &b, const KeyIter &e ) const
 {
     return find_impl( b, e, findFrom );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >     template<typename KeyIter>   inline
-typename trie<KeyType,ValueType,Traits > :: iterator 
-trie<KeyType,ValueType,Traits > :: find( const KeyIter &b, const KeyIter &e )
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: find( const KeyIter &b, const KeyIter &e )
 {
-    return find_impl( b, e, typename trie<KeyType,ValueType,Traits > :: iterator( this, false ) );
+    return find_impl( b, e, typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator( this, false ) );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >     template<typename KeyIter>   inline
-typename trie<KeyType,ValueType,Traits > :: iterator 
-trie<KeyType,ValueType,Traits > :: find( typename trie<KeyType,ValueType,Traits > :: iterator findFrom, const KeyIter &b, const KeyIter &e )
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: find( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator findFrom, const KeyIter &b, const KeyIter &e )
 {
     return find_impl( b, e, findFrom );
 }
 
 
-template < typename KeyType, typename ValueType, typename Traits >     inline
-typename trie<KeyType,ValueType,Traits > :: const_iterator 
-trie<KeyType,ValueType,Traits > :: find( typename trie<KeyType,ValueType,Traits > :: key_type k ) const
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+const typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: mapped_type* 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: lookup( KeyIter b, const KeyIter &e ) const
+{
+    value_index idx = lookup_impl( b, e );
+    return idx==value_index_npos ? 0 : &values[idx];
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: mapped_type* 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: lookup( KeyIter b, const KeyIter &e )
+{
+    value_index idx = lookup_impl( b, e );
+    return idx==value_index_npos ? 0 : &values[idx];
+}
+
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_match_result 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: longest_match( KeyIter b, const KeyIter &e ) const
+{
+    size_type   len = 0;
+    value_index idx = longest_match_impl( b, e, len );
+    return idx==value_index_npos ? const_match_result() : const_match_result( len, &values[idx] );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: match_result 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: longest_match( KeyIter b, const KeyIter &e )
+{
+    size_type   len = 0;
+    value_index idx = longest_match_impl( b, e, len );
+    return idx==value_index_npos ? match_result() : match_result( len, &values[idx] );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+std::pair< typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator, typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator >
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: prefix_range( const KeyIter &b, const KeyIter &e ) const
+{
+    return prefix_range_impl( b, e, begin(), end() );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+std::pair< typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator, typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator >
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: prefix_range( const KeyIter &b, const KeyIter &e )
+{
+    return prefix_range_impl( b, e, begin(), end() );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: lower_bound( const KeyIter &b, const KeyIter &e ) const
+{
+    return bound_impl( b, e, begin(), end(), false );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: lower_bound( const KeyIter &b, const KeyIter &e )
+{
+    return bound_impl( b, e, begin(), end(), false );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: upper_bound( const KeyIter &b, const KeyIter &e ) const
+{
+    return bound_impl( b, e, begin(), end(), true );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: upper_bound( const KeyIter &b, const KeyIter &e )
+{
+    return bound_impl( b, e, begin(), end(), true );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: nth( size_type k ) const
+{
+    return nth_impl( k, end() );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: nth( size_type k )
+{
+    return nth_impl( k, end() );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: size_type 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: rank( KeyIter b, const KeyIter &e ) const
+{
+    size_type res = 0;
+    if (b==e || trie_nodes.empty())
+       return res;
+
+    trie_node_index nodeIdx = 0;
+    while(nodeIdx!=trie_node_index_npos && trie_nodes[nodeIdx].keys_size())
+       {
+        const trie_node &node = trie_nodes[nodeIdx];
+
+        bool bFound = false;
+        typename trie_node_data_item_holder::const_iterator foundIt = node.find_key( this, *b, bFound );
+        trie_node_data_item_index idx = node.nodeDataIteratorToLocalIndex( this, foundIt );
+
+        // all keys under lesser items are less
+        for(trie_node_data_item_index i=0; i!=idx; ++i)
+            res += node.get_data_item( this, i ).payload_count;
+
+        if (!bFound || ++b==e)
+           break;
+
+        // proper prefix of the key is less than the key
+        const trie_node_data_item &item = node.get_data_item( this, idx );
+        if (item.value_idx!=value_index_npos)
+           ++res;
+
+        nodeIdx = item.child_idx;
+       }
+
+    return res;
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+std::pair< typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator, typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator >
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: equal_range( const KeyIter &b, const KeyIter &e ) const
+{
+    return std::make_pair( lower_bound( b, e ), upper_bound( b, e ) );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+std::pair< typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator, typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator >
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: equal_range( const KeyIter &b, const KeyIter &e )
+{
+    return std::make_pair( lower_bound( b, e ), upper_bound( b, e ) );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: size_type 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: count_prefix( const KeyIter &b, const KeyIter &e ) const
 {
-    return find_impl( k, typename trie<KeyType,ValueType,Traits > :: const_iterator( this, false ) );
+    if (b==e)
+       return values_size();
+
+    const_iterator it = find( b, e );
+    if (it.is_end_iter())
+       return 0;
+
+    return it.get_node_data_item().payload_count; // includes the prefix itself
 }
 
-template < typename KeyType, typename ValueType, typename Traits >     inline
-typename trie<KeyType,ValueType,Traits > :: const_iterator 
-trie<KeyType,ValueType,Traits > :: find( typename trie<KeyType,ValueType,Traits > :: const_iterator findFrom, typename trie<KeyType,ValueType,Traits > :: key_type k ) const
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter, typename Handler>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: size_type 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: tokenize( KeyIter b, const KeyIter &e, Handler h ) const
+{
+    size_type nTokens = 0;
+
+    while(b!=e)
+       {
+        size_type   len = 0;
+        value_index idx = longest_match_impl( b, e, len );
+        if (idx==value_index_npos)
+           {
+            h( b, size_type(1), (const mapped_type*)0 );
+            ++b;
+            continue;
+           }
+
+        h( b, len, &values[idx] );
+        std::advance( b, (difference_type)len );
+        ++nTokens;
+       }
+
+    return nTokens;
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename KeyIter, typename Handler>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: size_type 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: fuzzy_find( KeyIter b, const KeyIter &e, size_type maxDistance, Handler h ) const
+{
+    size_type nFound = 0;
+    if (trie_nodes.empty() || !trie_nodes[0].keys_size())
+       return nFound;
+
+    const std::vector<key_type> query( b, e );
+
+    if (maxDistance>(size_type(-1)>>1))
+        maxDistance = size_type(-1)>>1; // cap of DP cells must not overflow
+
+    // row of the empty prefix
+    fuzzy_find_rows r( query, maxDistance );
+    r.rows.resize( r.width );
+    for(size_type j=0; j!=r.width; ++j)
+        r.rows[j] = j;
+
+    const_iterator it = end();
+    fuzzy_find_impl( r, it, h, nFound );
+
+    return nFound;
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     template<typename Automaton, typename Handler>   inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: size_type 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: match_automaton( const Automaton &a, Handler h ) const
+{
+    size_type nFound = 0;
+    if (trie_nodes.empty() || !trie_nodes[0].keys_size())
+       return nFound;
+
+    const typename Automaton::state_type st = a.start();
+    if (a.is_dead(st))
+       return nFound;
+
+    const_iterator it = end();
+    match_automaton_impl( a, st, it, h, nFound );
+
+    return nFound;
+}
+
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: find( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: key_type k ) const
+{
+    return find_impl( k, typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator( const_cast< trie<KeyType,ValueType,Traits,IndexType,Allocator >* >(this), false ) );
+}
+
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: find( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator findFrom, typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: key_type k ) const
 {
     return find_impl( k, findFrom );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >     inline
-typename trie<KeyType,ValueType,Traits > :: iterator 
-trie<KeyType,ValueType,Traits > :: find( typename trie<KeyType,ValueType,Traits > :: key_type k )
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: find( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: key_type k )
 {
-    return find_impl( k, typename trie<KeyType,ValueType,Traits > :: iterator( this, false ) );
+    return find_impl( k, typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator( this, false ) );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >     inline
-typename trie<KeyType,ValueType,Traits > :: iterator 
-trie<KeyType,ValueType,Traits > :: find( typename trie<KeyType,ValueType,Traits > :: iterator findFrom, typename trie<KeyType,ValueType,Traits > :: key_type k )
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >     inline
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: find( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator findFrom, typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: key_type k )
 {
     return find_impl( k, findFrom );
 }
 
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline
-typename trie<KeyType,ValueType,Traits > :: iterator 
-trie<KeyType,ValueType,Traits > :: 
-erase( typename trie<KeyType,ValueType,Traits > :: iterator  what )
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
+erase( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator  what )
 {
     return erase_impl( what );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline bool
-trie<KeyType,ValueType,Traits > :: 
-is_payloaded( const typename trie<KeyType,ValueType,Traits > :: const_iterator &i ) const
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
+is_payloaded( const typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator &i ) const
 {
     return i.is_payloaded();
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline bool 
-trie<KeyType,ValueType,Traits > :: 
-is_payloaded( const typename trie<KeyType,ValueType,Traits > :: iterator &i )
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
+is_payloaded( const typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator &i )
 {
     return i.is_payloaded();
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline
-typename trie<KeyType,ValueType,Traits > :: mapped_type& 
-trie<KeyType,ValueType,Traits > :: 
-payload( typename trie<KeyType,ValueType,Traits > :: iterator where
-       , const typename trie<KeyType,ValueType,Traits > :: mapped_type &v )
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: mapped_type& 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
+payload( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator where
+       , const typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: mapped_type &v )
 {
-    trie_node_index             lastNodeIdx   = where.get_node_index();
-    trie_node_data_item_index   dataItemIdx   = where.get_node_data_index();
-    return set_node_value( lastNodeIdx, dataItemIdx, v );
+    return set_path_value( where, v );
 }
 
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline void 
-trie<KeyType,ValueType,Traits > :: 
-remove_payload( typename trie<KeyType,ValueType,Traits > :: iterator where )
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
+remove_payload( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator where )
 {
-    trie_node_index             lastNodeIdx   = where.get_node_index();
-    trie_node_data_item_index   dataItemIdx   = where.get_node_data_index();
-    remove_node_value( lastNodeIdx, dataItemIdx );
+    remove_path_value( where );
 }
 
 //! Получаем ссылку на нагрузку
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline
-typename trie<KeyType,ValueType,Traits > :: mapped_type& 
-trie<KeyType,ValueType,Traits > :: 
-payload( typename trie<KeyType,ValueType,Traits > :: iterator where )
+typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: mapped_type& 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
+payload( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: iterator where )
 {
     return where.payload();
 }
 
 //!< Получаем const ссылку на нагрузку
-template < typename KeyType, typename ValueType, typename Traits >
+template < typename KeyType, typename ValueType, typename Traits, typename IndexType, typename Allocator >
 inline
-const typename trie<KeyType,ValueType,Traits > :: mapped_type& 
-trie<KeyType,ValueType,Traits > :: 
-payload( typename trie<KeyType,ValueType,Traits > :: const_iterator where ) const
+const typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: mapped_type& 
+trie<KeyType,ValueType,Traits,IndexType,Allocator > :: 
+payload( typename trie<KeyType,ValueType,Traits,IndexType,Allocator > :: const_iterator where ) const
 {
     return where.payload();
 }
@@ -2386,14 +3944,17 @@ payload( typename trie<KeyType,ValueType,Traits > :: const_iterator where ) cons
 
 template < typename KeyType
          , typename ValueType
-         , typename Traits = std::less< typename KeyType::value_type >
+         , typename Traits    = std::less< typename KeyType::value_type >
+         , typename IndexType = std::size_t
+         , typename Allocator = std::allocator< ValueType >
          >
 class trie_map
 {
 
 public:
 
-    typedef trie< typename KeyType::value_type, ValueType, Traits >      trie_type;
+    typedef trie< typename KeyType::value_type, ValueType, Traits, IndexType, Allocator >  trie_type;
+    typedef Allocator                                                                     allocator_type;
 
     // typedef typename allocator_type::const_pointer const_pointer;
     // typedef typename allocator_type::const_reference const_reference;
@@ -2414,6 +3975,9 @@ public:
     typedef Traits                                              key_compare;
     typedef ValueType                                           mapped_type;
 
+    typedef typename trie_type::match_result                    match_result;
+    typedef typename trie_type::const_match_result              const_match_result;
+
 protected:
 
     trie_type            m_trie;
@@ -2425,8 +3989,15 @@ public:
     explicit 
     trie_map( const Traits& Comp ) : m_trie(Comp) {}
 
+    explicit 
+    trie_map( const allocator_type& a ) : m_trie(a) {}
+
+    trie_map( const Traits& Comp, const allocator_type& a ) : m_trie(Comp, a) {}
+
     trie_map( const trie_map& r ) : m_trie(r.m_trie) {}
 
+    trie_map( const trie_map& r, const allocator_type& a ) : m_trie(r.m_trie, a) {}
+
     template<class InputIterator>
     trie_map( InputIterator f, InputIterator l )
     {
@@ -2434,14 +4005,16 @@ public:
     }
 
     template<class InputIterator>
-    trie_map( InputIterator f, InputIterator l, const Traits& Comp )
-    : m_trie(Comp)
+    trie_map( InputIterator f, InputIterator l, const Traits& Comp, const allocator_type& a = allocator_type() )
+    : m_trie(Comp, a)
     {
         insert( f, l );
     }
 
-    typename trie_type& get_base()                 { return m_trie; }
-    const typename trie_type& get_base() const     { return m_trie; }
+    trie_type& get_base()                          { return m_trie; }
+    const trie_type& get_base() const              { return m_trie; }
+
+    allocator_type get_allocator() const           { return m_trie.get_allocator(); }
 
     size_type get_used_mem() const        { return m_trie.get_used_mem(); }
 
@@ -2461,9 +4034,113 @@ public:
 
     size_type count( const key_type& k ) const
     {
-        typename trie_type::const_iterator it = m_trie.find( k.begin(), k.end() );
-        if (it.is_end_iter() || !it.is_payloaded()) return 0;
-        return 1;
+        return find_value( k ) ? 1 : 0;
+    }
+
+    //! Возвращает указатель на значение по ключу или 0; итератор не строится
+    const mapped_type* find_value( const key_type& k ) const
+    {
+        return m_trie.lookup( k.begin(), k.end() );
+    }
+
+    mapped_type* find_value( const key_type& k )
+    {
+        return m_trie.lookup( k.begin(), k.end() );
+    }
+
+    //! Наибольший префикс [b,e), являющийся ключом словаря
+    template<typename KeyIter>
+    const_match_result longest_match( KeyIter b, const KeyIter &e ) const
+    {
+        return m_trie.longest_match( b, e );
+    }
+
+    template<typename KeyIter>
+    match_result longest_match( KeyIter b, const KeyIter &e )
+    {
+        return m_trie.longest_match( b, e );
+    }
+
+    const_match_result longest_match( const key_type& k ) const
+    {
+        return m_trie.longest_match( k.begin(), k.end() );
+    }
+
+    match_result longest_match( const key_type& k )
+    {
+        return m_trie.longest_match( k.begin(), k.end() );
+    }
+
+    //! Диапазон ключей, начинающихся с prefix
+    std::pair<const_iterator,const_iterator> prefix_range( const key_type& prefix ) const
+    {
+        std::pair<typename trie_type::const_iterator,typename trie_type::const_iterator> r = m_trie.prefix_range( prefix.begin(), prefix.end() );
+        return std::pair<const_iterator,const_iterator>( r.first, r.second );
+    }
+
+    std::pair<iterator,iterator> prefix_range( const key_type& prefix )
+    {
+        std::pair<typename trie_type::iterator,typename trie_type::iterator> r = m_trie.prefix_range( prefix.begin(), prefix.end() );
+        return std::pair<iterator,iterator>( r.first, r.second );
+    }
+
+    //! См. trie::compact
+    void compact() { m_trie.compact(); }
+
+    size_type count_prefix( const key_type& prefix ) const
+    {
+        return m_trie.count_prefix( prefix.begin(), prefix.end() );
+    }
+
+    const_iterator lower_bound( const key_type& k ) const { return m_trie.lower_bound( k.begin(), k.end() ); }
+    iterator       lower_bound( const key_type& k )       { return m_trie.lower_bound( k.begin(), k.end() ); }
+    const_iterator upper_bound( const key_type& k ) const { return m_trie.upper_bound( k.begin(), k.end() ); }
+    iterator       upper_bound( const key_type& k )       { return m_trie.upper_bound( k.begin(), k.end() ); }
+
+    std::pair<const_iterator,const_iterator> equal_range( const key_type& k ) const
+    {
+        return std::pair<const_iterator,const_iterator>( lower_bound(k), upper_bound(k) );
+    }
+
+    std::pair<iterator,iterator> equal_range( const key_type& k )
+    {
+        return std::pair<iterator,iterator>( lower_bound(k), upper_bound(k) );
+    }
+
+    //! k-й (с нуля) по порядку ключ
+    const_iterator nth( size_type k ) const { return m_trie.nth( k ); }
+    iterator       nth( size_type k )       { return m_trie.nth( k ); }
+
+    //! Количество ключей, меньших k
+    size_type rank( const key_type& k ) const { return m_trie.rank( k.begin(), k.end() ); }
+
+    //! Нечёткий поиск, см. trie::fuzzy_find; h(const const_iterator &it, distance), ключ доступен как it->first
+    template<typename Handler>
+    size_type fuzzy_find( const key_type& query, size_type maxDistance, Handler h ) const
+    {
+        return m_trie.fuzzy_find( query.begin(), query.end(), maxDistance
+                                , [&h]( const typename trie_type::const_iterator &it, size_type d ) { h( const_iterator(it), d ); }
+                                );
+    }
+
+    //! Ключи, допускаемые автоматом, см. trie::match_automaton; h(const const_iterator &it)
+    template<typename Automaton, typename Handler>
+    size_type match_automaton( const Automaton &a, Handler h ) const
+    {
+        return m_trie.match_automaton( a, [&h]( const typename trie_type::const_iterator &it ) { h( const_iterator(it) ); } );
+    }
+
+    //! Разбор буфера на ключи словаря по наибольшему совпадению, см. trie::tokenize
+    template<typename Handler>
+    size_type tokenize( const key_type& buf, Handler h ) const
+    {
+        return m_trie.tokenize( buf.begin(), buf.end(), h );
+    }
+
+    template<typename KeyIter, typename Handler>
+    size_type tokenize( KeyIter b, const KeyIter &e, Handler h ) const
+    {
+        return m_trie.tokenize( b, e, h );
     }
 
     size_type size() const  { return m_trie.values_size(); }
@@ -2475,19 +4152,18 @@ public:
     {
         MARTY_ADT_TRIE_IMPL_ASSERT( where.is_payloaded() && "iterator has no payload" );
         iterator res = m_trie.erase_impl(where);
-        if (!where.is_end_iter() && !where.is_payloaded())
-           where.move_to_prev_payloaded_impl();
+        if (!res.is_end_iter() && !res.is_payloaded())
+           res.move_to_next_payloaded_impl();
         return res;
     }
 
     iterator erase( iterator f, iterator l )
     {
-        if (f==l) return f;
-        while( f != --l )
-           {
-            erase( l );
-           }
-        return erase( l );
+        // erase shifts item indexes, so l is not valid after the first erase
+        difference_type n = std::distance( f, l );
+        for(; n; --n)
+           f = erase( f );
+        return f;
     }
 
     size_type erase( const key_type& k )
@@ -2520,7 +4196,7 @@ public:
         return std::make_pair(it,newInserted);
     }
 
-    iterator insert( iterator where, const value_type& _Val )
+    iterator insert( iterator where, const value_type& v )
     {
         return insert( v ).first; // ignore hint
     }
@@ -2535,6 +4211,21 @@ public:
            }
     }
 
+    //! Заменяет содержимое, [f,l) должна быть отсортирована по ключу (см. trie::assign_sorted)
+    template<class ForwardIterator>
+    void assign_sorted( ForwardIterator f, ForwardIterator l )
+    {
+        m_trie.assign_sorted( f, l );
+    }
+
+    template<class ForwardIterator>
+    static trie_map build_sorted( ForwardIterator f, ForwardIterator l, const Traits& Comp = Traits() )
+    {
+        trie_map res(Comp);
+        res.assign_sorted( f, l );
+        return res;
+    }
+
     void swap( trie_map &t )
     {
         m_trie.swap(t.m_trie);
@@ -2553,17 +4244,41 @@ public:
     }
 
     //UNDONE:
-    //equal_range 
-    //get_allocator 
     //key_comp
-    //lower_bound
     //max_size 
-    //upper_bound 
     //value_comp 
 
 }; // trie_map
 
 
+
+#if defined(MARTY_ADT_TRIE_HAS_PMR)
+
+//! trie и trie_map, выделяющие память из std::pmr::memory_resource
+/*! Например, trie, созданный в std::pmr::monotonic_buffer_resource, не освобождает память поэлементно:
+    она возвращается сразу вся при разрушении ресурса.
+ */
+namespace pmr {
+
+template < typename KeyType
+         , typename ValueType
+         , typename Traits    = std::less< KeyType >
+         , typename IndexType = std::size_t
+         >
+using trie = marty::containers::trie< KeyType, ValueType, Traits, IndexType, std::pmr::polymorphic_allocator< ValueType > >;
+
+template < typename KeyType
+         , typename ValueType
+         , typename Traits    = std::less< typename KeyType::value_type >
+         , typename IndexType = std::size_t
+         >
+using trie_map = marty::containers::trie_map< KeyType, ValueType, Traits, IndexType, std::pmr::polymorphic_allocator< ValueType > >;
+
+} // namespace pmr
+
+#endif
+
+
 }; // namespace containers
 }; // namespace marty
 
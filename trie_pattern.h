@@ -0,0 +1,593 @@
+/*! \file
+    \author Alexander Martynov (Marty AKA al-martyn1) <amart@mail.ru>
+    \copyright (c) 2014-2026 Alexander Martynov
+    \brief Шаблоны glob и упрощённые регулярные выражения, компилируемые в ДКА для обхода trie (trie::match_automaton)
+
+    Repository: https://github.com/al-martyn1/marty_containers
+
+    Шаблон сопоставляется с ключом целиком. Шаблон разбирается в НКА (построение Томпсона),
+    НКА детерминизируется заранее, поэтому trie_pattern после построения только читается
+    и может использоваться из нескольких потоков.
+
+    Алфавит ДКА - не символы, а интервалы символов, которые шаблон не различает: переходы хранятся
+    по интервалам, для каждого состояния хранится список диапазонов символов, не ведущих в тупик
+    (live_ranges), по нему trie::match_automaton выбирает элементы узла бинарным поиском.
+
+    glob:  * - любая последовательность, ? - любой символ, [abc], [a-z], [!a-z] или [^a-z] - класс символов,
+           \\c - символ c.
+    regex: c, \\c, . (любой символ), [...] (как в glob, отрицание - ^), (r), r|r, r*, r+, r?.
+*/
+
+#pragma once
+
+#include "exceptions.h"
+//
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//----------------------------------------------------------------------------
+// MARTY_CONTAINERS_TRIE_PATTERN_MAX_DFA_STATES - ограничение на число состояний ДКА (детерминизация может быть экспоненциальной)
+
+#if !defined(MARTY_CONTAINERS_TRIE_PATTERN_MAX_DFA_STATES)
+    #define MARTY_CONTAINERS_TRIE_PATTERN_MAX_DFA_STATES 65536
+#endif
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+// marty::containers::
+namespace marty {
+namespace containers {
+
+//----------------------------------------------------------------------------
+
+
+
+//----------------------------------------------------------------------------
+template<typename CharType>
+class trie_pattern
+{
+    static_assert(std::is_integral<CharType>::value, "trie_pattern requires integral char type");
+
+public: // types
+
+    typedef CharType                                  char_type;
+    typedef std::basic_string<CharType>               string_type;
+    typedef std::size_t                               size_type;
+    typedef std::size_t                               state_type;
+
+    typedef std::pair<CharType,CharType>              char_range; //!< [first,second]
+    typedef std::vector<char_range>                   ranges_holder;
+
+    static constexpr state_type                       dead_state = static_cast<state_type>(-1);
+
+
+protected: // types
+
+    static constexpr size_type npos = static_cast<size_type>(-1);
+
+    // Thompson NFA state: epsilon edges and at most one edge by char class
+    struct nfa_state
+    {
+        std::vector<size_type>   eps;
+        ranges_holder            cls;
+        size_type                target = npos;
+    };
+
+    struct nfa_fragment
+    {
+        size_type   start;
+        size_type   accept;
+    };
+
+    struct dfa_state
+    {
+        std::vector<state_type>  next;      // by alphabet interval
+        ranges_holder            live;      // merged intervals with non-dead transitions
+        bool                     accepting = false;
+    };
+
+    // parser and NFA are used only while building
+    struct builder
+    {
+        const string_type       &pattern;
+        size_type                pos;
+        std::vector<nfa_state>   nfa;
+
+        explicit builder( const string_type &p ) : pattern(p), pos(0), nfa() {}
+    };
+
+
+protected: // member fields
+
+    std::vector<CharType>     interval_starts; // sorted, the first one is the minimal char
+    std::vector<dfa_state>    dfa;
+
+
+public: // ctors
+
+    trie_pattern() : interval_starts(), dfa() {}
+
+    trie_pattern( const trie_pattern & ) = default;
+    trie_pattern( trie_pattern && ) = default;
+    trie_pattern& operator=( const trie_pattern & ) = default;
+    trie_pattern& operator=( trie_pattern && ) = default;
+
+    //! Компилирует glob-шаблон, при ошибке бросает pattern_syntax_error
+    static trie_pattern glob( const string_type &pattern )
+    {
+        builder b(pattern);
+        nfa_fragment f = parse_glob(b);
+        trie_pattern res;
+        res.build_dfa(b, f);
+        return res;
+    }
+
+    //! Компилирует регулярное выражение, при ошибке бросает pattern_syntax_error
+    static trie_pattern regex( const string_type &pattern )
+    {
+        builder b(pattern);
+        nfa_fragment f = parse_alternation(b);
+        if (b.pos!=pattern.size())
+            throw pattern_syntax_error("trie_pattern: unbalanced parenthesis");
+        trie_pattern res;
+        res.build_dfa(b, f);
+        return res;
+    }
+
+
+public: // automaton API, see trie::match_automaton
+
+    state_type start() const                   { return dfa.empty() ? dead_state : state_type(0); }
+    bool is_dead( state_type s ) const         { return s==dead_state; }
+    bool is_accepting( state_type s ) const    { return s!=dead_state && dfa[s].accepting; }
+
+    state_type next( state_type s, const CharType &c ) const
+    {
+        if (s==dead_state)
+            return dead_state;
+        size_type i = (size_type)(std::upper_bound(interval_starts.begin(), interval_starts.end(), c) - interval_starts.begin()) - 1;
+        return dfa[s].next[i];
+    }
+
+    const ranges_holder& live_ranges( state_type s ) const { return dfa[s].live; }
+
+    size_type states_size() const { return dfa.size(); }
+
+    //! Проверка последовательности без trie
+    template<typename Iter>
+    bool matches( Iter b, const Iter &e ) const
+    {
+        state_type s = start();
+        for(; b!=e && s!=dead_state; ++b)
+            s = next( s, *b );
+        return is_accepting(s);
+    }
+
+    bool matches( const string_type &str ) const
+    {
+        return matches( str.begin(), str.end() );
+    }
+
+
+protected: // NFA construction
+
+    static size_type add_state( builder &b )
+    {
+        b.nfa.push_back(nfa_state());
+        return b.nfa.size()-1;
+    }
+
+    static nfa_fragment make_empty( builder &b )
+    {
+        size_type s = add_state(b);
+        return nfa_fragment{ s, s };
+    }
+
+    static nfa_fragment make_class( builder &b, const ranges_holder &cls )
+    {
+        size_type s = add_state(b);
+        size_type a = add_state(b);
+        b.nfa[s].cls    = cls;
+        b.nfa[s].target = a;
+        return nfa_fragment{ s, a };
+    }
+
+    static nfa_fragment make_char( builder &b, CharType c )
+    {
+        return make_class( b, ranges_holder(1, char_range(c, c)) );
+    }
+
+    static nfa_fragment make_any( builder &b )
+    {
+        return make_class( b, ranges_holder(1, char_range(std::numeric_limits<CharType>::min(), std::numeric_limits<CharType>::max())) );
+    }
+
+    static nfa_fragment make_concat( builder &b, const nfa_fragment &f1, const nfa_fragment &f2 )
+    {
+        b.nfa[f1.accept].eps.push_back(f2.start);
+        return nfa_fragment{ f1.start, f2.accept };
+    }
+
+    static nfa_fragment make_alternation( builder &b, const nfa_fragment &f1, const nfa_fragment &f2 )
+    {
+        size_type s = add_state(b);
+        size_type a = add_state(b);
+        b.nfa[s].eps.push_back(f1.start);
+        b.nfa[s].eps.push_back(f2.start);
+        b.nfa[f1.accept].eps.push_back(a);
+        b.nfa[f2.accept].eps.push_back(a);
+        return nfa_fragment{ s, a };
+    }
+
+    // bSkip - zero repetitions allowed, bRepeat - more than one repetition allowed
+    static nfa_fragment make_repeat( builder &b, const nfa_fragment &f, bool bSkip, bool bRepeat )
+    {
+        size_type s = add_state(b);
+        size_type a = add_state(b);
+        b.nfa[s].eps.push_back(f.start);
+        if (bSkip)
+            b.nfa[s].eps.push_back(a);
+        if (bRepeat)
+            b.nfa[f.accept].eps.push_back(f.start);
+        b.nfa[f.accept].eps.push_back(a);
+        return nfa_fragment{ s, a };
+    }
+
+
+protected: // parsers
+
+    static bool at_end( const builder &b )      { return b.pos>=b.pattern.size(); }
+    static CharType peek( const builder &b )    { return b.pattern[b.pos]; }
+    static bool is_char( CharType c, char ch )  { return c==(CharType)ch; }
+
+    static CharType parse_escaped( builder &b )
+    {
+        ++b.pos; // backslash
+        if (at_end(b))
+            throw pattern_syntax_error("trie_pattern: trailing backslash");
+        return b.pattern[b.pos++];
+    }
+
+    // sorts and merges ranges
+    static void normalize_ranges( ranges_holder &r )
+    {
+        std::sort(r.begin(), r.end());
+        ranges_holder res;
+        for(typename ranges_holder::const_iterator it=r.begin(); it!=r.end(); ++it)
+        {
+            if (!res.empty() && (res.back().second>=it->first || res.back().second+1==it->first))
+            {
+                if (it->second>res.back().second)
+                    res.back().second = it->second;
+                continue;
+            }
+            res.push_back(*it);
+        }
+        r.swap(res);
+    }
+
+    static ranges_holder negate_ranges( const ranges_holder &r )
+    {
+        ranges_holder res;
+        CharType from = std::numeric_limits<CharType>::min();
+        bool bTail = true;
+        for(typename ranges_holder::const_iterator it=r.begin(); it!=r.end(); ++it)
+        {
+            if (it->first>from)
+                res.push_back(char_range(from, (CharType)(it->first-1)));
+            if (it->second==std::numeric_limits<CharType>::max())
+            {
+                bTail = false;
+                break;
+            }
+            from = (CharType)(it->second+1);
+        }
+        if (bTail)
+            res.push_back(char_range(from, std::numeric_limits<CharType>::max()));
+        return res;
+    }
+
+    // [abc], [a-z], [!...] (glob) or [^...]; ']' right after '[' or negation is literal
+    static ranges_holder parse_class( builder &b, bool bGlob )
+    {
+        ++b.pos; // '['
+
+        bool bNegate = false;
+        if (!at_end(b) && (is_char(peek(b), '^') || (bGlob && is_char(peek(b), '!'))))
+        {
+            bNegate = true;
+            ++b.pos;
+        }
+
+        ranges_holder r;
+        bool bFirst = true;
+        for(;;)
+        {
+            if (at_end(b))
+                throw pattern_syntax_error("trie_pattern: unterminated character class");
+
+            CharType c = peek(b);
+            if (is_char(c, ']') && !bFirst)
+            {
+                ++b.pos;
+                break;
+            }
+            bFirst = false;
+
+            CharType lo = is_char(c, '\\') ? parse_escaped(b) : b.pattern[b.pos++];
+            CharType hi = lo;
+
+            if (b.pos+1<b.pattern.size() && is_char(peek(b), '-') && !is_char(b.pattern[b.pos+1], ']'))
+            {
+                ++b.pos; // '-'
+                hi = is_char(peek(b), '\\') ? parse_escaped(b) : b.pattern[b.pos++];
+                if (hi<lo)
+                    throw pattern_syntax_error("trie_pattern: invalid character range");
+            }
+
+            r.push_back(char_range(lo, hi));
+        }
+
+        normalize_ranges(r);
+        return bNegate ? negate_ranges(r) : r;
+    }
+
+    static nfa_fragment parse_glob( builder &b )
+    {
+        nfa_fragment f = make_empty(b);
+        while(!at_end(b))
+        {
+            CharType c = peek(b);
+            if (is_char(c, '*'))
+            {
+                ++b.pos;
+                f = make_concat( b, f, make_repeat( b, make_any(b), true, true ) );
+            }
+            else if (is_char(c, '?'))
+            {
+                ++b.pos;
+                f = make_concat( b, f, make_any(b) );
+            }
+            else if (is_char(c, '['))
+            {
+                f = make_concat( b, f, make_class( b, parse_class(b, true) ) );
+            }
+            else if (is_char(c, '\\'))
+            {
+                f = make_concat( b, f, make_char( b, parse_escaped(b) ) );
+            }
+            else
+            {
+                ++b.pos;
+                f = make_concat( b, f, make_char( b, c ) );
+            }
+        }
+        return f;
+    }
+
+    static nfa_fragment parse_alternation( builder &b )
+    {
+        nfa_fragment f = parse_sequence(b);
+        while(!at_end(b) && is_char(peek(b), '|'))
+        {
+            ++b.pos;
+            f = make_alternation( b, f, parse_sequence(b) );
+        }
+        return f;
+    }
+
+    static nfa_fragment parse_sequence( builder &b )
+    {
+        nfa_fragment f = make_empty(b);
+        while(!at_end(b) && !is_char(peek(b), '|') && !is_char(peek(b), ')'))
+            f = make_concat( b, f, parse_repeat(b) );
+        return f;
+    }
+
+    static nfa_fragment parse_repeat( builder &b )
+    {
+        nfa_fragment f = parse_atom(b);
+        while(!at_end(b))
+        {
+            CharType c = peek(b);
+            if (is_char(c, '*'))
+                f = make_repeat( b, f, true, true );
+            else if (is_char(c, '+'))
+                f = make_repeat( b, f, false, true );
+            else if (is_char(c, '?'))
+                f = make_repeat( b, f, true, false );
+            else
+                break;
+            ++b.pos;
+        }
+        return f;
+    }
+
+    static nfa_fragment parse_atom( builder &b )
+    {
+        CharType c = peek(b);
+
+        if (is_char(c, '('))
+        {
+            ++b.pos;
+            nfa_fragment f = parse_alternation(b);
+            if (at_end(b) || !is_char(peek(b), ')'))
+                throw pattern_syntax_error("trie_pattern: unbalanced parenthesis");
+            ++b.pos;
+            return f;
+        }
+
+        if (is_char(c, '*') || is_char(c, '+') || is_char(c, '?'))
+            throw pattern_syntax_error("trie_pattern: quantifier without operand");
+
+        if (is_char(c, '['))
+            return make_class( b, parse_class(b, false) );
+
+        if (is_char(c, '.'))
+        {
+            ++b.pos;
+            return make_any(b);
+        }
+
+        if (is_char(c, '\\'))
+            return make_char( b, parse_escaped(b) );
+
+        ++b.pos;
+        return make_char( b, c );
+    }
+
+
+protected: // subset construction
+
+    static void eps_closure( const builder &b, std::vector<size_type> &set )
+    {
+        std::vector<bool> inSet(b.nfa.size(), false);
+        for(size_type i=0; i!=set.size(); ++i)
+            inSet[set[i]] = true;
+
+        // set grows while it is scanned
+        for(size_type i=0; i!=set.size(); ++i)
+        {
+            const std::vector<size_type> &eps = b.nfa[set[i]].eps;
+            for(size_type j=0; j!=eps.size(); ++j)
+            {
+                if (!inSet[eps[j]])
+                {
+                    inSet[eps[j]] = true;
+                    set.push_back(eps[j]);
+                }
+            }
+        }
+
+        std::sort(set.begin(), set.end());
+    }
+
+    void build_dfa( const builder &b, const nfa_fragment &f )
+    {
+        const CharType cMin = std::numeric_limits<CharType>::min();
+        const CharType cMax = std::numeric_limits<CharType>::max();
+
+        // chars between two neighbour boundaries are indistinguishable
+        interval_starts.assign(1, cMin);
+        for(size_type n=0; n!=b.nfa.size(); ++n)
+        {
+            const ranges_holder &cls = b.nfa[n].cls;
+            for(typename ranges_holder::const_iterator it=cls.begin(); it!=cls.end(); ++it)
+            {
+                interval_starts.push_back(it->first);
+                if (it->second!=cMax)
+                    interval_starts.push_back((CharType)(it->second+1));
+            }
+        }
+        std::sort(interval_starts.begin(), interval_starts.end());
+        interval_starts.erase(std::unique(interval_starts.begin(), interval_starts.end()), interval_starts.end());
+
+        const size_type nIntervals = interval_starts.size();
+
+        // intervals [firstInterval, lastInterval] covered by char edge of each NFA state
+        std::vector< std::vector< std::pair<size_type,size_type> > > covered(b.nfa.size());
+        for(size_type n=0; n!=b.nfa.size(); ++n)
+        {
+            const ranges_holder &cls = b.nfa[n].cls;
+            for(typename ranges_holder::const_iterator it=cls.begin(); it!=cls.end(); ++it)
+            {
+                size_type first = (size_type)(std::lower_bound(interval_starts.begin(), interval_starts.end(), it->first ) - interval_starts.begin());
+                size_type last  = (size_type)(std::upper_bound(interval_starts.begin(), interval_starts.end(), it->second) - interval_starts.begin()) - 1;
+                covered[n].push_back(std::make_pair(first, last));
+            }
+        }
+
+        std::map< std::vector<size_type>, state_type > stateIds;
+        std::vector< std::vector<size_type> >          stateSets;
+        std::deque< state_type >                       queue;
+
+        std::vector<size_type> startSet(1, f.start);
+        eps_closure(b, startSet);
+        stateIds[startSet] = 0;
+        stateSets.push_back(startSet);
+        dfa.push_back(dfa_state());
+        queue.push_back(0);
+
+        while(!queue.empty())
+        {
+            const state_type s = queue.front();
+            queue.pop_front();
+
+            const std::vector<size_type> set = stateSets[s];
+
+            dfa[s].accepting = std::binary_search(set.begin(), set.end(), f.accept);
+            dfa[s].next.assign(nIntervals, dead_state);
+
+            for(size_type i=0; i!=nIntervals; ++i)
+            {
+                std::vector<size_type> moveSet;
+                for(size_type k=0; k!=set.size(); ++k)
+                {
+                    const size_type n = set[k];
+                    for(size_type r=0; r!=covered[n].size(); ++r)
+                    {
+                        if (covered[n][r].first<=i && i<=covered[n][r].second)
+                        {
+                            moveSet.push_back(b.nfa[n].target);
+                            break;
+                        }
+                    }
+                }
+
+                if (moveSet.empty())
+                    continue;
+
+                eps_closure(b, moveSet);
+
+                typename std::map< std::vector<size_type>, state_type >::const_iterator idIt = stateIds.find(moveSet);
+                if (idIt!=stateIds.end())
+                {
+                    dfa[s].next[i] = idIt->second;
+                    continue;
+                }
+
+                if (dfa.size()>=(size_type)MARTY_CONTAINERS_TRIE_PATTERN_MAX_DFA_STATES)
+                    throw pattern_syntax_error("trie_pattern: pattern is too complex");
+
+                const state_type t = (state_type)dfa.size();
+                stateIds[moveSet] = t;
+                stateSets.push_back(moveSet);
+                dfa.push_back(dfa_state());
+                queue.push_back(t);
+                dfa[s].next[i] = t;
+            }
+
+            for(size_type i=0; i!=nIntervals; ++i)
+            {
+                if (dfa[s].next[i]==dead_state)
+                    continue;
+
+                const CharType lo = interval_starts[i];
+                const CharType hi = i+1<nIntervals ? (CharType)(interval_starts[i+1]-1) : cMax;
+
+                if (!dfa[s].live.empty() && dfa[s].live.back().second+1==lo && lo!=cMin)
+                    dfa[s].live.back().second = hi;
+                else
+                    dfa[s].live.push_back(char_range(lo, hi));
+            }
+        }
+    }
+
+}; // class trie_pattern
+
+//----------------------------------------------------------------------------
+
+} // namespace containers
+} // namespace marty
+